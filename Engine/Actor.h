@@ -20,42 +20,107 @@
 #include "EngineUtils.h"
 #include "ImageDB.h"
 #include "ComponentDB.h"
+#include "ComponentRecord.h"
+#include "ActorSlotMap.h"
 #include "Renderer.h"
 #include "glm/glm.hpp" // Student : You need to get glm added to your project source code or this line will fail.
 #include "PhysicsHandler.h"
 
 class Actor;
+struct ActorBlueprint;
 
 class ActorDB
 {
 public:
     static int numAddedComponents;
+    
+    // The number of components that have been initialized since the game started, gives each one its initOrder
+    static long long numInitializedComponents;
+};
+
+// The components on an actor that are of one type
+struct ComponentTypeIndex
+{
+    // Sorted by key, the order GetComponent looks through them in
+    std::vector<std::shared_ptr<ComponentRecord>> components;
+    
+    // The last table GetComponents returned and the components that were in it.
+    // It is handed out again until a component is added, removed, enabled or disabled.
+    std::shared_ptr<luabridge::LuaRef> cachedTable;
+    std::vector<ComponentRecord*> cachedComponents;
+};
+
+// Empty component map nodes an actor keeps to reuse.
+// Copying an actor doesn't copy them, the copy starts with none.
+struct ComponentNodeCache
+{
+    std::vector<std::map<std::string, std::shared_ptr<ComponentRecord>>::node_type> nodes;
+    
+    ComponentNodeCache() {}
+    ComponentNodeCache(const ComponentNodeCache&) {}
+    ComponentNodeCache& operator=(const ComponentNodeCache&) {return *this;}
 };
 
 class Actor
 {
 private:
+    // The initialized components on this actor by type
+    std::unordered_map<std::string, ComponentTypeIndex> componentsByType;
+    
+    // Calls "OnDestroy" on an initialized component and takes it out of every list on this actor
+    void RemoveInitializedComponent(std::map<std::string, std::shared_ptr<ComponentRecord>>::iterator component);
+    
+    // The nodes of started and removed components, InitNewComponents puts new components in them instead of allocating
+    ComponentNodeCache spareComponentNodes;
+    
+    // Empties a node and keeps it for InitNewComponents
+    void KeepSpareNode(std::map<std::string, std::shared_ptr<ComponentRecord>>::node_type node);
+    
     
 public:
     std::string name = "";
     int ID = -1;
     
+    // This actor's handle in the scene it is in, invalid until the scene adds it
+    ActorHandle handle = ActorSlotMap::INVALID_HANDLE;
+    
     bool enabled = true;
     bool destroyOnLoad = true;
     bool destroyed = false;
     
-    std::map<std::string, std::shared_ptr<luabridge::LuaRef>> components;
-    std::map<std::string, std::shared_ptr<luabridge::LuaRef>> componentsToAdd;
+    // Tags the actor can be found by, set with "tags" in its JSON or from Lua
+    std::unordered_set<std::string> tags;
+    
+    // True once the current scene has this actor in its name and tag indices
+    bool indexed = false;
+    
+    // True while the actor is waiting in the current scene's actorsToAdd
+    bool pending = false;
+    
+    // True while the current scene has this actor queued to initialize, start or remove components
+    bool queuedNewComponents = false;
+    bool queuedAddedComponents = false;
+    bool queuedRemovedComponents = false;
+    
+    // The template this actor was instantiated from, empty for actors loaded from a scene
+    std::string templateName = "";
+    
+    // How far the actor is outside the camera's view and the frame that was worked out on, so throttled updates only work it out once a frame
+    float cameraDistance = 0.0f;
+    int cameraDistanceFrame = -1;
+    
+    std::map<std::string, std::shared_ptr<ComponentRecord>> components;
+    std::map<std::string, std::shared_ptr<ComponentRecord>> componentsToAdd;
     std::vector<std::string> componentsToRemove;
     
-    std::queue<std::string> componentsToUpdate;
-    std::queue<std::string> componentsToUpdateLate;
-    std::unordered_set<std::string> componentsWithOnDestroy;
+    // Components initialized since the scene last collected them into its update lists
+    std::vector<std::shared_ptr<ComponentRecord>> newComponents;
+    
+    // The components of a destroyed actor, their map nodes are moved here so ActorPool can give them back to it
+    std::map<std::string, std::shared_ptr<ComponentRecord>> recycledComponents;
     
-    std::priority_queue<std::string> componentsWithCollisionEnter;
-    std::priority_queue<std::string> componentsWithCollisionExit;
-    std::priority_queue<std::string> componentsWithTriggerEnter;
-    std::priority_queue<std::string> componentsWithTriggerExit;
+    // The components with each contact function (OnCollisionEnter, OnCollisionExit, OnTriggerEnter, OnTriggerExit), sorted by key
+    std::vector<std::shared_ptr<ComponentRecord>> contactHandlers[ON_TRIGGER_EXIT - ON_COLLISION_ENTER + 1];
     
     
     // Called the frame an actor is loaded
@@ -64,26 +129,24 @@ public:
     // Processes all components added to the actor on this frame
     void ProcessAddedComponents();
     
-    // Calls "OnUpdate" for every component on this actor that has it
-    void Update();
+    // Processes all components removed from the actor on this frame, returns true if any were removed
+    bool ProcessRemovedComponents();
     
-    // Calls "OnLateUpdate" for every component on this actor that has it
-    void LateUpdate();
+    // Calls a contact function (OnCollisionEnter, OnCollisionExit, OnTriggerEnter or OnTriggerExit) on every component on this actor that has it
+    void CallContactFunction(LifecycleFunction function, const Collision& col);
     
-    // Processes all components removed from the actor on this frame
-    void ProcessRemovedComponents();
+    // Calls "OnReset" on the components of an actor that was reused from its template's pool.
+    // The components are the same tables and C++ objects the destroyed actor had, so a reference another script kept to one
+    // now reaches this actor. Scripts that keep components of other actors should drop them when those actors are destroyed.
+    void CallOnReset();
     
-    // Calls OnCollisionEnter on every component on this actor that has it
-    void CollisionEnter(Collision col);
+    // Puts a destroyed actor back the way its template made it so it can be instantiated again.
+    // Returns false if it can't be, which happens when components were added or removed while it was alive.
+    bool ResetToTemplate(const Actor& templateActor);
     
-    // Calls OnCollisionExit on every component on this actor that has it
-    void CollisionExit(Collision col);
-
-    // Calls OnTriggerEnter on every component on this actor that has it
-    void TriggerEnter(Collision col);
-
-    // Calls OnTriggerExit on every component on this actor that has it
-    void TriggerExit(Collision col);
+    // Finds where the actor is from its Transform, or its Rigidbody if it doesn't have one.
+    // Returns false if it has neither
+    bool GetWorldPosition(b2Vec2& position);
     
     // Returns this actors name
     std::string GetName();
@@ -91,6 +154,15 @@ public:
     // Returns this actors ID
     int GetID();
     
+    // Tags this actor so Actor.FindWithTag can find it
+    void AddTag(std::string tag);
+    
+    // Removes a tag from this actor
+    void RemoveTag(std::string tag);
+    
+    // Returns true if this actor has the tag
+    bool HasTag(std::string tag);
+    
     // Adds a new component of the type name given to this actor and returns a reference to it
     luabridge::LuaRef AddComponent(std::string type_name);
     
@@ -108,10 +180,15 @@ public:
     luabridge::LuaRef GetComponent(std::string type_name);
     
     // Returns all of the components on this actor that are of the given type
+    // The table is reused between calls while the components don't change, so Lua shouldn't modify it
     luabridge::LuaRef GetComponents(std::string type_name);
     
     // Injects a reference to this actor into the components so that developers can get the actor that a component is on.
-    void InjectConvenienceReferences(std::shared_ptr<luabridge::LuaRef> component_ref);
+    // Lua components get the actor's handle, C++ components keep the actor too so they don't have to look it up.
+    void InjectConvenienceReferences(ComponentRecord& record);
+    
+    // Makes this actor a new copy of a compiled template
+    void Clone(const ActorBlueprint& blueprint);
     
     // Initializes an actor with the values in JSON code
     void LoadActorWithJSON(const rapidjson::Value& actorData);
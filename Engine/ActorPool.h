@@ -0,0 +1,48 @@
+//
+//  ActorPool.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/16/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef ActorPool_h
+#define ActorPool_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+class Actor;
+
+// Keeps destroyed actors for each template so instantiating it again can reuse them.
+// A reused actor keeps its component tables and C++ components, they are reset to the template's values.
+// Lua that still holds one of a destroyed actor's components (not the actor itself, ActorRefs go stale) reaches the new actor through it,
+// which is why pooling is off unless the game asks for it.
+class ActorPool
+{
+public:
+    // Destroyed actors are only reused if this is true, set "actor_pooling" to true in game.config to turn it on
+    static inline bool enabled = false;
+    
+    // The most actors kept for one template, any more are freed
+    static const size_t MAX_POOLED_ACTORS = 256;
+    
+    // Returns an actor that was made from the template and has been reset, or nullptr if there isn't one
+    static std::shared_ptr<Actor> Take(const std::string& templateName);
+    
+    // Resets a destroyed actor and keeps it for the next time its template is instantiated.
+    // It is freed instead if anything else still owns it or it no longer matches its template.
+    static void Return(std::shared_ptr<Actor> actor);
+    
+    // Frees every pooled actor
+    static void Clear();
+    
+private:
+    static inline std::unordered_map<std::string, std::vector<std::shared_ptr<Actor>>> pools;
+};
+
+#endif /* ActorPool_h */
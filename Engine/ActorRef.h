@@ -0,0 +1,92 @@
+//
+//  ActorRef.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/23/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef ActorRef_h
+#define ActorRef_h
+
+#include <stdio.h>
+#include <string>
+
+#include "lua.hpp"
+#include "LuaBridge.h"
+
+#include "ActorSlotMap.h"
+
+class Actor;
+
+// What Lua holds instead of an actor: the actor's handle in the current scene.
+// Every call looks the handle up first, so once the actor has been removed (even if its slot went to another actor)
+// its functions do nothing and return nil, "", -1 or false.
+struct ActorRef
+{
+    ActorHandle handle = ActorSlotMap::INVALID_HANDLE;
+    
+    ActorRef() {}
+    explicit ActorRef(ActorHandle handle) : handle(handle) {}
+    
+    // Refers to the actor, or to nothing (nil in Lua) for nullptr
+    explicit ActorRef(const Actor* actor);
+    
+    // Returns the actor this refers to, or nullptr if it isn't in the current scene anymore
+    Actor* Get() const;
+    
+    // Equal if they refer to the same actor, this is "__eq" in Lua
+    bool operator==(const ActorRef& other) const {return handle == other.handle;}
+    
+    // The actor's functions in Lua
+    std::string GetName() const;
+    int GetID() const;
+    luabridge::LuaRef GetComponentByKey(std::string key) const;
+    luabridge::LuaRef GetComponent(std::string type_name) const;
+    luabridge::LuaRef GetComponents(std::string type_name) const;
+    luabridge::LuaRef AddComponent(std::string type_name) const;
+    void RemoveComponent(luabridge::LuaRef component_ref) const;
+    void AddTag(std::string tag) const;
+    void RemoveTag(std::string tag) const;
+    bool HasTag(std::string tag) const;
+};
+
+namespace luabridge {
+
+// ActorRefs go to Lua by value and one that doesn't refer to anything is nil, so scripts can still check Find's result against nil
+template <>
+struct Stack<ActorRef>
+{
+    static void push(lua_State* L, const ActorRef& actor)
+    {
+        if (actor.handle == ActorSlotMap::INVALID_HANDLE)
+        {
+            lua_pushnil(L);
+            return;
+        }
+        detail::UserdataValue<ActorRef>::push(L, actor);
+    }
+    
+    static ActorRef get(lua_State* L, int index)
+    {
+        if (lua_isnil(L, index)) {return ActorRef();}
+        return *detail::Userdata::get<ActorRef>(L, index, true);
+    }
+    
+    static bool isInstance(lua_State* L, int index)
+    {
+        return lua_isnil(L, index) || detail::Userdata::isInstance<ActorRef>(L, index);
+    }
+};
+
+// Fields and arguments that are ActorRefs are copied the same way
+template <>
+struct Stack<ActorRef&> : Stack<ActorRef> {};
+
+template <>
+struct Stack<const ActorRef&> : Stack<ActorRef> {};
+
+} // namespace luabridge
+
+#endif /* ActorRef_h */
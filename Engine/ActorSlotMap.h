@@ -0,0 +1,94 @@
+//
+//  ActorSlotMap.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/15/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef ActorSlotMap_h
+#define ActorSlotMap_h
+
+#include <stdio.h>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+class Actor;
+
+// Identifies an actor in a scene, the low bits are its slot and the high bits are the slot's generation.
+// Handles to destroyed actors stop working once their slot is freed, even after the slot is reused.
+typedef uint32_t ActorHandle;
+
+// Holds the actors in a scene.
+// Slots own the actors and hand out generational handles, while a dense array of pointers
+// kept in ID order (the order actors were loaded in) is what the scene iterates over.
+class ActorSlotMap
+{
+public:
+    static const ActorHandle INVALID_HANDLE = 0xFFFFFFFF;
+
+    // Adds an actor and gives it its handle, an actor that already claimed one keeps it
+    ActorHandle Insert(std::shared_ptr<Actor> actor);
+    
+    // Gives an actor a handle without adding it to the actors that are iterated over, Insert adds it once it is in the scene
+    ActorHandle Claim(std::shared_ptr<Actor> actor);
+
+    // Removes the actor with the given handle, does nothing if the handle is stale
+    void Remove(ActorHandle handle);
+    
+    // Removes the actors with the given handles, the rest of the actors are only shifted down once
+    void Remove(const std::vector<ActorHandle>& handles);
+
+    // Returns the actor with the given handle (inserted or only claimed), or nullptr if it has been removed
+    Actor* Get(ActorHandle handle) const;
+    std::shared_ptr<Actor> GetShared(ActorHandle handle) const;
+
+    // Returns true if the actor has been inserted into this map
+    bool Contains(const Actor* actor) const;
+
+    // Returns the actor with the given ID, or nullptr if there isn't one
+    Actor* FindByID(int ID) const;
+
+    // Removes every actor, their handles stay stale after the slots are reused
+    void Clear();
+    
+    // Makes room for count actors so adding them doesn't reallocate
+    void Reserve(size_t count);
+
+    size_t size() const {return dense.size();}
+    bool empty() const {return dense.empty();}
+
+    // Iterates over the actors in ID order
+    std::vector<Actor*>::const_iterator begin() const {return dense.begin();}
+    std::vector<Actor*>::const_iterator end() const {return dense.end();}
+
+private:
+    static const int INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    struct Slot
+    {
+        std::shared_ptr<Actor> actor;
+        uint32_t generation = 0;
+        
+        // False while the actor is only claimed, it isn't in the dense array until it's inserted
+        bool inserted = false;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+
+    // Every actor in the map sorted by ID
+    std::vector<Actor*> dense;
+
+    // Returns the slot a handle points to if it is still valid
+    const Slot* GetSlot(ActorHandle handle) const;
+    
+    // Empties a slot and moves it on to its next generation
+    void FreeSlot(uint32_t index);
+};
+
+#endif /* ActorSlotMap_h */
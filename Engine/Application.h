@@ -34,9 +34,7 @@ public:
     // Precision is the number of decimal places you want to be randomized
     static float RandomNumber(float min, float max, int precision)
     {
-        // Random number engine
-        std::random_device rd;
-        std::mt19937 gen(rd());
+        std::mt19937& gen = GetRandomEngine();
         
         int r_min = min * precision;
         int r_max = max * precision;
@@ -49,6 +47,12 @@ public:
         return num;
     }
     
+    // Restarts the random number engine from a fixed seed so runs can be reproduced
+    static void SeedRandom(unsigned int seed)
+    {
+        GetRandomEngine().seed(seed);
+    }
+    
     // Puts the application to sleep for the specified number of milliseconds
     static void Sleep(int duration_ms)
     {
@@ -75,6 +79,14 @@ public:
         std::system(command.c_str());
         
     }
+    
+private:
+    // The random number engine shared by every RandomNumber call, seeded from the OS unless SeedRandom is called
+    static std::mt19937& GetRandomEngine()
+    {
+        static std::mt19937 gen{std::random_device{}()};
+        return gen;
+    }
 };
 
 #endif /* Application_h */
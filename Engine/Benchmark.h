@@ -0,0 +1,85 @@
+//
+//  Benchmark.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/13/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef Benchmark_h
+#define Benchmark_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+#include "SDL2/SDL.h"
+
+#include "EngineUtils.h"
+
+// Replays a recorded input file (the same format as sdl_user_input.txt) with fixed seeds and a fixed timestep,
+// then reports frame time percentiles, heap allocations (counted in game_engine_benchmark builds) and a checksum of the final game state.
+// Run with: game_engine --benchmark --game <game directory> --replay <input file> [--seed N] [--frames N] [--benchmark-out results.json]
+class Benchmark
+{
+public:
+    // True when running as a benchmark
+    static bool active;
+
+    // The seed every random number generator is started with
+    static unsigned int seed;
+    static bool seedSet;
+
+    // The input file to play back, empty uses the normal sdl_user_input.txt
+    static std::string replayPath;
+
+    // Where to write the results as JSON, empty only prints them
+    static std::string outputPath;
+
+    // The number of C++ heap allocations and bytes allocated since the program started.
+    // They are only counted in builds with GAME_ENGINE_COUNT_ALLOCATIONS defined, so other builds don't pay for it on every allocation
+    static std::atomic<long long> allocations;
+    static std::atomic<long long> bytesAllocated;
+#ifdef GAME_ENGINE_COUNT_ALLOCATIONS
+    static const bool countsAllocations = true;
+#else
+    static const bool countsAllocations = false;
+#endif
+
+    // Points the input playback at the replay file, has to be set before the first event is polled
+    static void SetReplay(const std::string& path);
+
+    // Seeds the random number generators and starts measuring, called once everything is loaded
+    static void Init();
+
+    // The number of frames the replay file has input for, 0 if there's no replay
+    static int GetReplayLength();
+
+    // Records how long the frame that just finished took
+    static void EndFrame();
+
+    // Hashes everything that should come out the same on every run of the same replay (FNV-1a)
+    static uint64_t ComputeChecksum();
+
+private:
+    // Every frame time in milliseconds since the benchmark started
+    static std::vector<double> frameTimes;
+
+    // The performance counter value at the end of the last frame
+    static Uint64 lastFrameEnd;
+
+    // The allocation counts when the benchmark started, so loading isn't included
+    static long long startAllocations;
+    static long long startBytesAllocated;
+
+    // Gets the frame time at the given percentile (0 - 100)
+    static double GetPercentile(std::vector<double>& sortedTimes, double percentile);
+
+    // Prints the results (and writes them to outputPath), registered with atexit so games that quit themselves still report
+    static void Report();
+};
+
+#endif /* Benchmark_h */
@@ -0,0 +1,82 @@
+//
+//  BytecodeCache.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/22/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef BytecodeCache_h
+#define BytecodeCache_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "lua.hpp"
+
+#include "EngineUtils.h"
+
+// A Lua script and what it compiled to
+struct CompiledScript
+{
+    std::string path;
+    std::string source;
+    uint64_t sourceHash = 0;
+    
+    // lua_dump output, empty if the script didn't compile (running it then reports the error from its source)
+    std::string bytecode;
+    
+    // True if the bytecode came out of the cache instead of being compiled this run
+    bool fromCache = false;
+};
+
+// Keeps the compiled bytecode of component scripts in resources/.bytecode_cache so they don't have to be parsed every time the game starts.
+// Each entry is keyed by a hash of its script's source, scripts whose entry is missing or stale are compiled in parallel,
+// each in its own throwaway Lua state, and written back to the cache.
+// Set "lua_bytecode_cache" to false in game.config to always compile from source.
+class BytecodeCache
+{
+public:
+    static bool enabled;
+    
+    // Where cache entries are kept
+    static const std::string cacheDirectoryPath;
+    
+    // Reads the cache settings, has to run after game.config is loaded
+    static void Init();
+    
+    // Returns every script compiled, in the order given, using cached bytecode where it's still valid
+    static std::vector<CompiledScript> Compile(const std::vector<std::string>& paths);
+    
+    // Runs a compiled script in the given Lua state, falling back to its source if the bytecode won't load.
+    // Returns LUA_OK or the Lua error code with the message on top of the stack like luaL_dofile
+    static int Run(lua_State* luaState, const CompiledScript& script);
+
+private:
+    // Written at the start of every entry so files from other engine or Lua versions are ignored
+    static const uint32_t CACHE_MAGIC = 0x43424547; // "GEBC"
+    static const uint32_t CACHE_VERSION = LUA_VERSION_NUM * 100 + 1;
+    
+    // Hashes a script's source (FNV-1a)
+    static uint64_t HashSource(const std::string& source);
+    
+    // Returns the path of the cache entry for a script
+    static std::string GetEntryPath(const std::string& scriptPath);
+    
+    // Loads a script's bytecode from its cache entry, returns false if the entry is missing or was made from other source
+    static bool ReadEntry(CompiledScript& script);
+    
+    // Writes a script's bytecode to its cache entry
+    static void WriteEntry(const CompiledScript& script);
+    
+    // Compiles a script's source to bytecode in a Lua state of its own, safe to call from any thread
+    static void CompileSource(CompiledScript& script);
+    
+    // The lua_Writer that lua_dump writes the bytecode through
+    static int WriteBytecode(lua_State* state, const void* data, size_t size, void* output);
+};
+
+#endif /* BytecodeCache_h */
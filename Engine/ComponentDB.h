@@ -19,6 +19,7 @@
 #include "PhysicsHandler.h"
 
 class Actor;
+class ComponentRecord;
 
 class ComponentDB
 {
@@ -46,14 +47,37 @@ public:
     // Makes a new copy of the given CPP component and returns it
     static luabridge::LuaRef CopyCPPComponent(shared_ptr<luabridge::LuaRef> component, std::string type);
 
+    // Creates a new table that inherits from parent_table and returns it
+    static luabridge::LuaRef NewInstance(luabridge::LuaRef & parent_table);
+    
     // Get a component from componentTables based on the components name
     static std::shared_ptr<luabridge::LuaRef> GetComponent(std::string componentName);
     
     // Establishes inheritance between two tables by setting one to be the metatable of another
     static void EstablishInheritance(luabridge::LuaRef & instance_table, luabridge::LuaRef & parent_table);
     
+    // Points a Lua component at its record so "enabled" and "started" are written to it, nullptr detaches it
+    static void AttachRecord(luabridge::LuaRef & instance_table, ComponentRecord* record);
+    
+    // Copies a record's flags into its Lua component's metatable, where Lua reads them from
+    static void SyncFlags(luabridge::LuaRef & instance_table, const ComponentRecord& record);
+    
+    // Returns the record of the Lua component at the given stack index, nullptr for anything else
+    static ComponentRecord* GetRecord(lua_State* state, int index);
+    
+    // Returns a number unique to the given component type, numbered in the order types are first seen
+    static int GetTypeIndex(const std::string& type);
+    
 private:
     static inline std::unordered_map<std::string, std::shared_ptr<luabridge::LuaRef>> componentTables;
+    static inline std::unordered_map<std::string, int> typeIndices;
+    
+    // Keys for a Lua component's record and parent in its metatable, only their addresses are used
+    static inline char recordKey;
+    static inline char parentKey;
+    
+    // __newindex for Lua components, sets the flags on the record and everything else on the component
+    static int ComponentNewIndex(lua_State* state);
     
     // Prints a debug message to cout
     static void Log(std::string message);
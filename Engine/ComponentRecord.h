@@ -0,0 +1,134 @@
+//
+//  ComponentRecord.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/14/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef ComponentRecord_h
+#define ComponentRecord_h
+
+#include <stdio.h>
+#include <string>
+#include <memory>
+
+#include "lua.hpp"
+#include "LuaBridge.h"
+
+struct Collision;
+struct NativeComponentType;
+
+// Every lifecycle function the engine calls on components
+enum LifecycleFunction
+{
+    ON_START,
+    ON_UPDATE,
+    ON_FIXED_UPDATE,
+    ON_LATE_UPDATE,
+    ON_DESTROY,
+    ON_COLLISION_ENTER,
+    ON_COLLISION_EXIT,
+    ON_TRIGGER_ENTER,
+    ON_TRIGGER_EXIT,
+    ON_RESET,
+    NUM_LIFECYCLE_FUNCTIONS
+};
+
+// How often a component's OnUpdate is called, set with "update_policy" on the component
+enum UpdatePolicy
+{
+    UPDATE_EVERY_FRAME,        // "every_frame", the default
+    UPDATE_EVERY_N_FRAMES,     // "every_n_frames", every "update_interval" frames wherever the actor is
+    UPDATE_BY_DISTANCE,        // "distance", every frame on camera and less often the further off camera, up to every "update_interval" frames
+    UPDATE_DORMANT_OFF_CAMERA  // "dormant_off_camera", every frame on camera and never off it
+};
+
+// The engine's side of a component.
+// Holds the component's flags and its lifecycle functions so calling them doesn't need any Lua string lookups.
+class ComponentRecord
+{
+public:
+    std::string key;
+    std::string type;
+    
+    // A small number for the type so lists can be grouped by it without comparing strings
+    int typeIndex = 0;
+    
+    // When the component was initialized, its actor calls its lifecycle functions in this order
+    long long initOrder = -1;
+    
+    // Set once the component has been removed from its actor, lists holding it drop it later
+    bool removed = false;
+    
+    // How often OnUpdate is called, read from the component with its lifecycle functions
+    UpdatePolicy updatePolicy = UPDATE_EVERY_FRAME;
+    int updateInterval = 1;
+
+    std::shared_ptr<luabridge::LuaRef> component;
+    
+    // The component's C++ type, nullptr for Lua components
+    const NativeComponentType* native = nullptr;
+
+    // Point at this record's own flags for Lua components, or at the members of C++ components.
+    // The engine reads the flags through these, they are changed with SetEnabled and SetStarted so Lua components see the change
+    bool* enabled = &ownEnabled;
+    bool* started = &ownStarted;
+
+    // Makes a record for a component, has to happen before the component's flags are set
+    ComponentRecord(const std::string& key, const std::string& type, const luabridge::LuaRef& component);
+    
+    // Makes a record for a copy of source's component, it starts with source's lifecycle functions instead of looking them up
+    ComponentRecord(const ComponentRecord& source, const luabridge::LuaRef& component);
+    ~ComponentRecord();
+
+    ComponentRecord(const ComponentRecord&) = delete;
+    ComponentRecord& operator=(const ComponentRecord&) = delete;
+
+    // Looks up the component's lifecycle functions and keeps references to them, only the first call does anything
+    void ResolveFunctions();
+
+    // Puts a component recycled from a destroyed actor back the way source is, so it can be used again.
+    // Lua components lose everything set on them and inherit from their type again, C++ components are copied from source.
+    void Reset(const ComponentRecord& source);
+
+    // Returns true if the component has the given lifecycle function
+    bool HasFunction(LifecycleFunction function) {return functionRefs[function] != LUA_NOREF;}
+
+    // Returns true if the component should have its lifecycle functions called
+    bool IsActive() {return *enabled && *started;}
+    
+    // Sets the component's flags, Lua components get a copy in their metatable where Lua reads them from
+    void SetEnabled(bool value);
+    void SetStarted(bool value);
+
+    // Calls a lifecycle function on the component, errors are printed with the actor's name
+    void Call(LifecycleFunction function, const std::string& actorName);
+    void Call(LifecycleFunction function, const Collision& col, const std::string& actorName);
+    void Call(LifecycleFunction function, float deltaTime, const std::string& actorName);
+
+private:
+    bool ownEnabled = true;
+    bool ownStarted = false;
+
+    bool resolved = false;
+
+    // Registry references to the component and its lifecycle functions
+    int selfRef = LUA_NOREF;
+    int functionRefs[NUM_LIFECYCLE_FUNCTIONS];
+
+    // Keeps a reference to the component and finds its flags
+    void Register();
+    
+    // Takes references to the lifecycle functions source has resolved
+    void CopyFunctions(const ComponentRecord& source);
+    
+    // Reads "update_policy" and "update_interval" from the component on top of the Lua stack
+    void ResolveUpdatePolicy();
+    
+    // Calls the function on the Lua stack with the component and numArgs - 1 other arguments
+    void Invoke(int numArgs, const std::string& actorName);
+};
+
+#endif /* ComponentRecord_h */
@@ -0,0 +1,164 @@
+//
+//  CoroutineScheduler.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/19/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef CoroutineScheduler_h
+#define CoroutineScheduler_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "lua.hpp"
+#include "LuaBridge.h"
+
+class ComponentRecord;
+
+// A hierarchical timing wheel. Timers far in the future sit in coarse slots and only move down
+// to finer ones as their tick gets close, so a waiting timer costs nothing until it is nearly due.
+class TimingWheel
+{
+public:
+    // Schedules id for the given tick, ids already due go straight into ready
+    void Insert(uint32_t id, uint64_t tick, std::vector<uint32_t>& ready);
+    
+    // Moves time forward to tick and appends every id that came due to ready, in the order they were due
+    void Advance(uint64_t tick, std::vector<uint32_t>& ready);
+    
+    uint64_t GetNow() const {return now;}
+
+private:
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 4;
+    
+    struct Timer
+    {
+        uint32_t id;
+        uint64_t tick;
+    };
+    
+    // Level 0 has a slot per tick, each level above it has a slot for every lap of the level below
+    std::vector<Timer> slots[LEVELS][SLOTS];
+    
+    // Timers further out than the top level reaches, looked at again every time it wraps around
+    std::vector<Timer> overflow;
+    
+    uint64_t now = 0;
+    size_t count = 0;
+    
+    // Takes every timer out of the list and inserts it again, which moves it down to a finer level
+    void Cascade(std::vector<Timer>& timers, std::vector<uint32_t>& ready);
+};
+
+// Runs Lua coroutines started with Coroutine.Start and resumes them when what they wait on happens.
+// Coroutines stop when they finish, when they are stopped, or when the component that started them is removed or destroyed.
+class CoroutineScheduler
+{
+public:
+    // Adds the Coroutine namespace to Lua
+    static void Initialize(lua_State* luaState);
+    
+    // Resumes every coroutine that is due this frame
+    static void Update();
+    
+    // Wakes the coroutines waiting on an event, they are resumed with the event object on the next update
+    static void NotifyEvent(const std::string& eventType, const luabridge::LuaRef& eventObject);
+    
+    // Stops every coroutine the component started, called when it is removed or its actor is destroyed
+    static void StopOwnedBy(ComponentRecord* record);
+
+private:
+    struct Coroutine
+    {
+        lua_State* thread = nullptr;
+        int threadRef = LUA_NOREF;
+        int ownerRef = LUA_NOREF;
+        
+        // What Lua passes the coroutine when it is next resumed, the event object for WaitForEvent
+        int resumeValueRef = LUA_NOREF;
+        
+        // The owner's record and its initOrder when the coroutine started, a recycled record has a new initOrder
+        ComponentRecord* ownerRecord = nullptr;
+        long long ownerInitOrder = -1;
+        
+        // The event the coroutine is in eventWaiters for, empty if it isn't waiting on one
+        std::string waitingForEvent;
+        
+        std::string actorName;
+        
+        uint32_t generation = 0;
+        bool active = false;
+        bool waiting = false;
+        bool stopped = false;
+    };
+    
+    // Handles are the coroutine's index in the low bits and its generation in the high bits, like actor handles
+    static const int INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t INVALID_HANDLE = 0xFFFFFFFF;
+    
+    static inline lua_State* luaState = nullptr;
+    
+    static inline std::vector<Coroutine> coroutines;
+    static inline std::vector<uint32_t> freeCoroutines;
+    
+    // The coroutine being resumed right now, Wait functions attach to it
+    static inline uint32_t running = INVALID_HANDLE;
+    
+    // Ticks of the frame wheel are frames, ticks of the time wheel are milliseconds of game time
+    static inline TimingWheel frameWheel;
+    static inline TimingWheel timeWheel;
+    
+    static inline std::unordered_map<std::string, std::vector<uint32_t>> eventWaiters;
+    
+    // The coroutines each component started that are still running, so they can be freed as soon as it's gone
+    static inline std::unordered_map<ComponentRecord*, std::vector<uint32_t>> coroutinesByOwner;
+    
+    // Coroutines due to be resumed, and the list being resumed, swapped each update so both keep their memory
+    static inline std::vector<uint32_t> readyCoroutines;
+    static inline std::vector<uint32_t> resumingCoroutines;
+    
+    // Coroutine.Start(component, function), starts running function straight away and returns a handle for Coroutine.Stop
+    static int Start(lua_State* state);
+    
+    // Coroutine.Stop(handle), does nothing if the coroutine already finished
+    static int Stop(lua_State* state);
+    
+    // Coroutine.WaitSeconds(seconds), Coroutine.WaitFrames(frames) and Coroutine.WaitForEvent(event_type), only from inside a coroutine.
+    // WaitForEvent returns the event object
+    static int WaitSeconds(lua_State* state);
+    static int WaitFrames(lua_State* state);
+    static int WaitForEvent(lua_State* state);
+    
+    // Returns the coroutine a handle points to if it is still running
+    static Coroutine* Get(uint32_t handle);
+    
+    // Returns the handle of the coroutine calling a Wait function, errors in Lua if it wasn't started by Coroutine.Start
+    static uint32_t GetRunning(lua_State* state, const char* functionName);
+    
+    // Returns false if the component that started the coroutine is gone
+    static bool IsOwnerAlive(const Coroutine& coroutine);
+    
+    // Resumes a coroutine with numArgs values already pushed onto its thread
+    static void Resume(uint32_t handle, int numArgs);
+    
+    // Lets go of a coroutine's Lua references and frees its handle
+    static void Free(uint32_t handle);
+    
+    // Takes a handle out of a list it is in, and the list out of its map once it's empty
+    template <typename Key>
+    static void RemoveHandle(std::unordered_map<Key, std::vector<uint32_t>>& lists, const Key& key, uint32_t handle);
+    
+    // The current game time in time wheel ticks
+    static uint64_t GetTimeTick();
+};
+
+#endif /* CoroutineScheduler_h */
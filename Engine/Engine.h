@@ -40,6 +40,9 @@ public:
     // Called to start the game
     static int Game();
     
+    // Reads the command line options (--headless, --frames N, --benchmark, --game DIR, --replay FILE, --seed N, --benchmark-out FILE)
+    static void ParseArguments(int argc, char* argv[]);
+    
 private:
     // The default font to be used when rendering text
     static string defaultFontName;
@@ -57,6 +60,12 @@ private:
     // True if the game should be quit out of
     static bool quit;
     
+    // The number of frames to run before quitting, 0 runs until the game quits itself
+    static int frameLimit;
+    
+    // The number of frames that have run so far
+    static int framesRun;
+    
     // The main loop of the game
     static int GameLoop();
     
@@ -71,6 +80,9 @@ private:
     
     // Draws debug tools called gizmos
     static void DrawGizmos();
+    
+    // Prints how fast the simulation ran, used by headless runs
+    static void PrintRunSummary(Uint64 startCounter);
 };
 
 #endif /* engine_h */
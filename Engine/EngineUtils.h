@@ -26,6 +26,9 @@ public:
     static rapidjson::Document game_config;
     static rapidjson::Document rendering_config;
     
+    // True when the engine runs without a window, renderer or audio device
+    static bool headless;
+    
     // Checks to make sure a directory exists, and throws an error if it doesn't and is maked as required.
     static bool ConfirmDirectory(std::string path, bool required);
     
@@ -0,0 +1,80 @@
+//
+//  FramePacer.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/11/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef FramePacer_h
+#define FramePacer_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "SDL2/SDL.h"
+
+#include "EngineUtils.h"
+
+// How the engine waits between frames
+enum class PacingMode
+{
+    VSync,    // The renderer presents on vertical blank and nothing else waits
+    Uncapped, // Frames run back to back as fast as they can
+    Hybrid    // Sleeps for most of the remaining frame time, then spins on the performance counter for the rest
+};
+
+// Decides how long each frame takes and keeps statistics on how long they actually took.
+// Set "frame_pacing" in rendering.config to "vsync", "uncapped" or "hybrid" and "frame_rate" in game.config for the hybrid target.
+// Without "frame_pacing" it uses vsync, unless "frame_rate" is set in which case it uses hybrid to hit it.
+class FramePacer
+{
+public:
+    static PacingMode mode;
+
+    // The number of frames per second the hybrid mode aims for
+    static double targetFrameRate;
+
+    // Reads the pacing settings, has to run before the renderer is created since vsync is a renderer flag
+    static void Init();
+
+    // True if the renderer should be created with SDL_RENDERER_PRESENTVSYNC
+    static bool UsesVSync() {return mode == PacingMode::VSync;}
+
+    // Waits until it's time for the next frame to be presented and records how long this frame took
+    static void EndFrame();
+
+    // How long EndFrame will wait if it's called now, 0 if frames aren't being held back
+    static double GetIdleSeconds();
+
+    // Frame time statistics over the last FRAME_HISTORY frames, in milliseconds
+    static float GetAverageFrameTime();
+    static float GetMinFrameTime();
+    static float GetMaxFrameTime();
+    static float GetPercentileFrameTime(float percentile);
+    static float GetP99FrameTime() {return GetPercentileFrameTime(99.0f);}
+
+private:
+    // The number of recent frames kept for the statistics
+    static const int FRAME_HISTORY = 240;
+
+    // Hybrid mode stops sleeping this long before the deadline, SDL_Delay can oversleep by about a millisecond
+    static constexpr double SPIN_SECONDS = 0.002;
+
+    // The performance counter value the current frame should be presented at
+    static Uint64 nextFrameDeadline;
+
+    // The performance counter value the last frame ended at
+    static Uint64 lastFrameEnd;
+
+    // The most recent frame times in milliseconds, used as a ring buffer
+    static std::vector<float> frameTimes;
+    static int nextFrameTimeIndex;
+
+    // Sleeps and then spins until the deadline
+    static void WaitUntil(Uint64 deadline);
+};
+
+#endif /* FramePacer_h */
@@ -53,6 +53,9 @@ public:
     /* The frame_number advances with every call to Helper::SDL_RenderPresent() */
     static inline int frame_number = 0;
     static inline Uint32 current_frame_start_timestamp = 0;
+
+    /* Set when the engine's FramePacer decides how long frames take, so SDL_Delay() doesn't sleep on top of it. */
+    static inline bool external_frame_pacing = false;
     static int GetFrameNumber() { return frame_number; }
 
     static SDL_Window* SDL_CreateWindow498(const char* title, int x, int y, int w, int h, Uint32 flags)
@@ -339,6 +342,10 @@ private:
         {
             //::SDL_Delay(1); Don't bother delaying at all. Gotta go fast when autograding.
         }
+        else if (external_frame_pacing)
+        {
+            /* The engine's frame pacer has already waited for this frame. */
+        }
         else
         {
             Uint32 current_frame_end_timestamp = SDL_GetTicks();  // Record end time of the frame
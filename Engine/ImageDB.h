@@ -24,6 +24,7 @@
 #include "Renderer.h"
 #include "SDL2_image/SDL_image.h"
 #include "SDL2/SDL.h"
+#include "JobSystem.h"
 
 
 class ImageDB
@@ -35,8 +36,17 @@ public:
     // Get an image from loadedImages based on the images name
     static SDL_Texture* GetImage(std::string imageName);
     
+    // Gets the size of an image in pixels without asking SDL
+    static void GetImageSize(const std::string& imageName, int& width, int& height);
+    
+    // Looks an image and its size up, returning false instead of exiting if it's missing so it's safe to call from worker threads
+    static bool FindImage(const std::string& imageName, SDL_Texture*& texture, int& width, int& height);
+    
 private:
     static inline std::unordered_map<std::string, SDL_Texture*> loadedImages;
+    
+    // The width and height of every loaded image, measured once when it's loaded
+    static inline std::unordered_map<std::string, SDL_Point> imageSizes;
 };
 
 #endif /* ImageDB_h */
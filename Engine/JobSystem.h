@@ -0,0 +1,89 @@
+//
+//  JobSystem.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/9/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef JobSystem_h
+#define JobSystem_h
+
+#include <stdio.h>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+#include "EngineUtils.h"
+
+using Job = std::function<void()>;
+
+// Counts the jobs in a group that haven't finished yet, wait on it to join them
+struct JobCounter
+{
+    std::atomic<int> remaining{0};
+};
+
+// A work-stealing thread pool for engine code.
+// Every thread has its own queue: it pushes and pops jobs at the back, while idle threads steal from the front of the others.
+// Only engine (C++) work belongs here, Lua and SDL rendering/audio calls must stay on the main thread.
+class JobSystem
+{
+public:
+    // Starts the worker threads, "worker_threads" in game.config overrides the default of one per extra core
+    static void Init();
+
+    // Finishes any queued jobs and joins the worker threads
+    static void Shutdown();
+
+    // Queues a job, the counter (if given) is decremented once it finishes.
+    // If dependency is given the job won't start its work until every job counted by it is done.
+    static void Run(Job job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    // Blocks until every job counted by the counter is done, running queued jobs while it waits
+    static void Wait(JobCounter* counter);
+
+    // Splits [0, count) into batches of batchSize and calls body(start, end) on each of them across the pool.
+    // Returns once every batch is done, small ranges just run on the calling thread.
+    static void ParallelFor(int count, int batchSize, const std::function<void(int, int)>& body);
+
+    // The number of threads besides the main thread that run jobs
+    static int GetWorkerCount() {return static_cast<int>(workers.size());}
+    
+    // The index of the thread calling this, 0 is the main thread and workers count up from 1
+    static int GetThreadIndex() {return threadIndex;}
+
+private:
+    struct WorkQueue
+    {
+        std::deque<Job> jobs;
+        std::mutex mutex;
+    };
+
+    // One queue per thread, the main thread's is index 0
+    static std::vector<std::unique_ptr<WorkQueue>> queues;
+    static std::vector<std::thread> workers;
+
+    // The index of the queue owned by the current thread
+    static thread_local int threadIndex;
+
+    // Lets idle workers sleep until there's something to do
+    static std::mutex sleepMutex;
+    static std::condition_variable wakeWorkers;
+    static std::atomic<int> queuedJobs;
+    static std::atomic<bool> running;
+
+    // Runs one job from this thread's queue or one stolen from another thread, returns false if there wasn't one
+    static bool RunOneJob();
+
+    // The loop each worker thread runs until shutdown
+    static void WorkerLoop(int index);
+};
+
+#endif /* JobSystem_h */
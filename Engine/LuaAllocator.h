@@ -0,0 +1,113 @@
+//
+//  LuaAllocator.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/21/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef LuaAllocator_h
+#define LuaAllocator_h
+
+#include <stdio.h>
+#include <cstddef>
+
+#include "lua.hpp"
+
+// Memory use of one size class
+struct LuaSizeClassStats
+{
+    size_t blockSize = 0;
+    size_t blocksInUse = 0;
+    size_t peakBlocksInUse = 0;
+    long long allocations = 0;
+    
+    // Memory taken from the system for this class, in use or not
+    size_t bytesReserved = 0;
+    
+    size_t GetBytesInUse() const {return blocksInUse * blockSize;}
+    size_t GetPeakBytesInUse() const {return peakBlocksInUse * blockSize;}
+};
+
+// Memory use of the blocks too big for any size class
+struct LuaLargeBlockStats
+{
+    size_t blocksInUse = 0;
+    size_t bytesInUse = 0;
+    size_t peakBytesInUse = 0;
+    long long allocations = 0;
+};
+
+// The allocator behind the Lua state. Tables, strings, closures and userdata are almost all small and short lived,
+// so blocks up to MAX_POOLED_SIZE come from free lists of fixed size classes carved out of big chunks, and anything larger goes to malloc.
+// Not thread safe, only the main Lua state uses it.
+class LuaAllocator
+{
+public:
+    // The largest block served from a size class
+    static const size_t MAX_POOLED_SIZE = 512;
+    
+    // The lua_Alloc function to pass to lua_newstate
+    static void* Allocate(void* userData, void* block, size_t oldSize, size_t newSize);
+    
+    // Makes a Lua state that allocates through this allocator and prints an error and exits on an unprotected error like luaL_newstate would
+    static lua_State* NewState();
+    
+    // How much memory is in use in each size class and in large blocks
+    static int GetSizeClassCount() {return SIZE_CLASS_COUNT;}
+    static const LuaSizeClassStats& GetSizeClassStats(int sizeClass);
+    static const LuaLargeBlockStats& GetLargeBlockStats() {return largeBlockStats;}
+    
+    // The bytes handed to Lua right now, counted by block size, and the bytes taken from the system for them
+    static size_t GetBytesInUse();
+    static size_t GetBytesReserved();
+
+private:
+    // Size classes are multiples of this, which also keeps every block aligned for any Lua value
+    static const size_t GRANULARITY = 16;
+    
+    // Each size class takes this much memory from the system at a time
+    static const size_t CHUNK_SIZE = 64 * 1024;
+    
+    static const int SIZE_CLASS_COUNT = 16;
+    
+    // A free block holds a pointer to the next free block of its class
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+    
+    struct SizeClass
+    {
+        FreeBlock* freeList = nullptr;
+        
+        // The part of the newest chunk that hasn't been handed out yet, blocks are carved from it as they're needed
+        char* carveNext = nullptr;
+        char* carveEnd = nullptr;
+    };
+    
+    // Plain arrays so nothing is destroyed at exit, LuaRefs held by other statics still free into Lua while the program shuts down
+    static SizeClass sizeClasses[SIZE_CLASS_COUNT];
+    static LuaSizeClassStats sizeClassStats[SIZE_CLASS_COUNT];
+    static LuaLargeBlockStats largeBlockStats;
+    
+    // The size class for each size in GRANULARITY steps, built the first time a block is allocated
+    static int classForSize[MAX_POOLED_SIZE / GRANULARITY + 1];
+    static bool initialized;
+    
+    // Returns the size class a size falls in, -1 for large blocks
+    static int GetSizeClass(size_t size);
+    
+    // Allocates and frees a block of the given size
+    static void* New(size_t size);
+    static void Delete(void* block, size_t size);
+    
+    // Sets up the size classes
+    static void InitSizeClasses();
+    
+    // Called by Lua on errors outside of a protected call
+    static int Panic(lua_State* state);
+};
+
+#endif /* LuaAllocator_h */
@@ -0,0 +1,83 @@
+//
+//  LuaGC.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/20/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef LuaGC_h
+#define LuaGC_h
+
+#include <stdio.h>
+#include <cstddef>
+
+#include "lua.hpp"
+#include "SDL2/SDL.h"
+
+#include "EngineUtils.h"
+
+// Which of Lua's collectors runs
+enum class LuaGCMode
+{
+    Incremental,  // Collects in small steps the engine runs at the end of each frame, Lua only collects on its own if the heap grows well past that
+    Generational  // Lua collects young objects on its own, the engine adds a young collection at the end of each frame
+};
+
+// Decides when Lua collects garbage so the work lands at the end of a frame instead of wherever a script happens to allocate.
+// Set "lua_gc_mode" in game.config to "incremental" or "generational", "lua_gc_budget_ms" for how long collecting may take
+// each frame and "lua_gc_pause" for how much the heap grows (in percent) before a new incremental cycle starts.
+class LuaGC
+{
+public:
+    static LuaGCMode mode;
+    
+    // The time collecting may take each frame, longer if the frame pacer would be waiting anyway
+    static double budgetMilliseconds;
+    
+    // A new incremental cycle starts once the heap is this percent of what it was after the last cycle
+    static int pause;
+    
+    // Reads the GC settings and switches the Lua state over to them, has to run after game.config is loaded
+    static void Init(lua_State* luaState);
+    
+    // Does this frame's collection work, called once the frame is done and before it's presented
+    static void Step();
+    
+    // The number of bytes Lua has allocated right now
+    static size_t GetHeapBytes();
+    
+    // Statistics for the frame that just finished and for every frame so far
+    static double GetLastCollectionTime() {return lastCollectionMilliseconds;}
+    static double GetMaxCollectionTime() {return maxCollectionMilliseconds;}
+    static double GetTotalCollectionTime() {return totalCollectionMilliseconds;}
+    static size_t GetPeakHeapBytes() {return peakHeapBytes;}
+    static int GetCompletedCycles() {return completedCycles;}
+
+private:
+    static lua_State* luaState;
+    
+    // Lua's own incremental collector waits this many times longer than the engine's pause before it starts a cycle
+    static const int BACKSTOP_PAUSE_MULTIPLIER = 2;
+    
+    // The largest pause Lua can store
+    static const int MAX_LUA_PAUSE = 1000;
+    
+    // True while an incremental cycle is partway done
+    static bool collecting;
+    
+    // The heap size when the last incremental cycle finished
+    static size_t heapAfterCycle;
+    
+    static double lastCollectionMilliseconds;
+    static double maxCollectionMilliseconds;
+    static double totalCollectionMilliseconds;
+    static size_t peakHeapBytes;
+    static int completedCycles;
+    
+    // Runs incremental steps until the cycle finishes or the time runs out
+    static void StepIncremental(Uint64 start, double budgetSeconds);
+};
+
+#endif /* LuaGC_h */
@@ -0,0 +1,435 @@
+//
+//  NativeComponentDB.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/18/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef NativeComponentDB_h
+#define NativeComponentDB_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include "lua.hpp"
+#include "LuaBridge.h"
+#include "rapidjson/document.h"
+
+#include "JobSystem.h"
+#include "ActorRef.h"
+
+class Actor;
+
+// The values every C++ component has, Lua reads them the same way it reads them on a Lua component
+class NativeComponent
+{
+public:
+    std::string type = "";
+    std::string key = "???";
+    Actor* actor = nullptr;
+    
+    // The actor's handle, Lua gets the actor through it so a component kept after its actor is gone can't reach it
+    ActorHandle actorHandle = ActorSlotMap::INVALID_HANDLE;
+    
+    bool enabled = true;
+    bool started = false;
+    
+    // Where this component is in its type's pool, -1 if it didn't come from one
+    int poolIndex = -1;
+    
+    // The initOrder of the component's record, the scene updates an actor's components in this order
+    long long initOrder = -1;
+    
+    // Where this component was in the last parallel update of its type, in the scene's update order.
+    // The commands it recorded are applied in this order
+    int commandOrder = 0;
+    
+    NativeComponent(const std::string& type) : type(type) {}
+    
+    // Copies keep their own place in the pool
+    NativeComponent(const NativeComponent& other) : type(other.type), key(other.key), actor(other.actor), actorHandle(other.actorHandle), enabled(other.enabled), started(other.started) {}
+    NativeComponent& operator=(const NativeComponent& other)
+    {
+        type = other.type;
+        key = other.key;
+        actor = other.actor;
+        actorHandle = other.actorHandle;
+        enabled = other.enabled;
+        started = other.started;
+        return *this;
+    }
+    
+    // The actor this component is on, as Lua reads it
+    ActorRef GetActor() const {return ActorRef(actorHandle);}
+};
+
+// A side effect a component recorded during a parallel update, applied on the main thread once every component is done
+struct NativeCommand
+{
+    // The commandOrder of the component that recorded it, commands are applied in this order
+    int order = 0;
+    
+    void (*apply)(NativeCommand& command) = nullptr;
+    NativeComponent* component = nullptr;
+    void* target = nullptr;
+    float values[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+// The commands recorded on one thread. Each thread has its own so recording doesn't need a lock
+class NativeCommandBuffer
+{
+public:
+    std::vector<NativeCommand> commands;
+    
+    // Records a command to apply to target later, the values are passed along to apply
+    void Record(void (*apply)(NativeCommand&), NativeComponent* component, void* target = nullptr, float a = 0.0f, float b = 0.0f, float c = 0.0f, float d = 0.0f)
+    {
+        NativeCommand& command = commands.emplace_back();
+        command.order = component->commandOrder;
+        command.apply = apply;
+        command.component = component;
+        command.target = target;
+        command.values[0] = a;
+        command.values[1] = b;
+        command.values[2] = c;
+        command.values[3] = d;
+    }
+};
+
+// Everything the engine needs to do with one type of C++ component, filled in when the type is declared
+struct NativeComponentType
+{
+    std::string name;
+    
+    // Makes a new component, or a copy of source, out of the type's pool
+    luabridge::LuaRef (*create)() = nullptr;
+    luabridge::LuaRef (*copy)(const luabridge::LuaRef& source) = nullptr;
+    
+    // Copies source over a component so it can be reused
+    void (*reset)(const luabridge::LuaRef& component, const luabridge::LuaRef& source) = nullptr;
+    
+    // Gives a component back to its pool once nothing in the engine uses it
+    void (*release)(const luabridge::LuaRef& component) = nullptr;
+    
+    // Returns the values every C++ component has
+    NativeComponent* (*getBase)(const luabridge::LuaRef& component) = nullptr;
+    
+    // Updates every started and enabled component of the type in one go, nullptr if the type is updated through Lua.
+    // Only used when updates are grouped by type, otherwise OnUpdate is called on each component in the scene's order
+    void (*batchUpdate)() = nullptr;
+    
+    // Sets a declared field from the component's JSON, by the field's name
+    std::unordered_map<std::string, std::function<void(NativeComponent*, const rapidjson::Value&)>> loaders;
+    
+    // Sets the declared fields named in a component's JSON, anything else in it is ignored
+    void LoadProperties(const luabridge::LuaRef& component, const rapidjson::Value& properties) const;
+};
+
+template <class T>
+class NativeComponentDeclaration;
+
+// Holds every type of C++ component.
+// A type is declared once with its fields and functions, which makes its Lua bindings, JSON loaders, pool and copies.
+class NativeComponentDB
+{
+public:
+    // Starts declaring a C++ component type, End() adds it
+    template <class T>
+    static NativeComponentDeclaration<T> Declare(lua_State* luaState, const std::string& name);
+    
+    // Adds a declared type, declaring the same name twice is an error
+    static void AddType(const NativeComponentType& type);
+    
+    // Returns the C++ component type with the given name, or nullptr if it is a Lua type
+    static const NativeComponentType* FindType(const std::string& name);
+    
+    // Runs the batch update of every type that has one, in the order they were declared. Only used when updates are grouped by type
+    static void BatchUpdate();
+    
+    // Returns true if the component should have its lifecycle functions called
+    static bool IsActive(const NativeComponent& component);
+    
+    // Returns true if the scene would update a before b, by actor ID and then initOrder
+    static bool UpdatesBefore(const NativeComponent* a, const NativeComponent* b);
+    
+    // Makes sure every thread in the job system has a command buffer, call before a parallel update starts
+    static void PrepareCommandBuffers();
+    
+    // The command buffer of the thread calling this
+    static NativeCommandBuffer& GetCommandBuffer() {return commandBuffers[JobSystem::GetThreadIndex()];}
+    
+    // Applies every recorded command on the main thread and empties the buffers.
+    // Commands are applied in the order of the components that recorded them, so how the work was split between threads doesn't matter.
+    static void ApplyCommands();
+    
+    // Reads a JSON value into a field, does nothing and returns false if the value is the wrong kind
+    static bool ReadJson(const rapidjson::Value& value, float& field);
+    static bool ReadJson(const rapidjson::Value& value, int& field);
+    static bool ReadJson(const rapidjson::Value& value, bool& field);
+    static bool ReadJson(const rapidjson::Value& value, std::string& field);
+    static bool ReadJson(const rapidjson::Value& value, std::vector<float>& field);
+    static bool ReadJson(const rapidjson::Value& value, std::vector<std::vector<float>>& field);
+
+private:
+    // Never freed, records of template components are still being destroyed when the program exits
+    static std::unordered_map<std::string, std::unique_ptr<NativeComponentType>>& GetTypes();
+    static inline std::vector<const NativeComponentType*> batchUpdatedTypes;
+    
+    // One per thread, indexed by JobSystem::GetThreadIndex
+    static inline std::vector<NativeCommandBuffer> commandBuffers;
+    
+    // Every buffer's commands gathered up to be sorted and applied, kept to reuse its memory
+    static inline std::vector<NativeCommand> mergedCommands;
+};
+
+// The components of one C++ type.
+// Released components stay where they are and are copied over when they are taken again, so nothing is allocated once the pool is warm.
+template <class T>
+class NativeComponentPool
+{
+public:
+    // The function BatchUpdate calls on every active component
+    static inline void (T::*batchFunction)() = nullptr;
+    
+    // The function the parallel batch update calls on every active component, from any thread
+    static inline void (T::*parallelFunction)(NativeCommandBuffer& buffer) = nullptr;
+    
+    // Takes a component from the pool, it is a copy of source or a new component if source is nullptr
+    static T* Allocate(const T* source)
+    {
+        Storage& storage = GetStorage();
+        T* component;
+        if (!storage.freeComponents.empty())
+        {
+            component = storage.freeComponents.back();
+            storage.freeComponents.pop_back();
+            *component = source != nullptr ? *source : GetPrototype();
+        }
+        else
+        {
+            if (source != nullptr)
+            {
+                storage.components.emplace_back(*source);
+            }
+            else
+            {
+                storage.components.emplace_back();
+            }
+            component = &storage.components.back();
+            component->poolIndex = static_cast<int>(storage.components.size()) - 1;
+            storage.inUse.push_back(0);
+        }
+        
+        storage.inUse[component->poolIndex] = 1;
+        return component;
+    }
+    
+    // Puts a component back in the pool, Lua must not be using it anymore
+    static void Release(T* component)
+    {
+        Storage& storage = GetStorage();
+        if (component->poolIndex < 0 || !storage.inUse[component->poolIndex]) {return;}
+        
+        storage.inUse[component->poolIndex] = 0;
+        storage.freeComponents.push_back(component);
+    }
+    
+    // Calls batchFunction on every component in use that is started and enabled on an enabled actor
+    static void UpdateAll()
+    {
+        Storage& storage = GetStorage();
+        
+        // Components made during the update haven't started, so they are skipped
+        for (size_t i = 0; i < storage.components.size(); i++)
+        {
+            if (!storage.inUse[i]) {continue;}
+            
+            T& component = storage.components[i];
+            if (!NativeComponentDB::IsActive(component)) {continue;}
+            
+            (component.*batchFunction)();
+        }
+    }
+    
+    // Calls parallelFunction on every active component across the job system, then applies what they recorded
+    static void UpdateAllParallel()
+    {
+        Storage& storage = GetStorage();
+        
+        storage.activeComponents.clear();
+        for (size_t i = 0; i < storage.components.size(); i++)
+        {
+            if (storage.inUse[i] && NativeComponentDB::IsActive(storage.components[i]))
+            {
+                storage.activeComponents.push_back(&storage.components[i]);
+            }
+        }
+        if (storage.activeComponents.empty()) {return;}
+        
+        // Pool indices are reused as actors come and go, so commands are ordered the way the scene would update the components instead
+        std::vector<T*>& activeComponents = storage.activeComponents;
+        std::sort(activeComponents.begin(), activeComponents.end(), &NativeComponentDB::UpdatesBefore);
+        for (size_t i = 0; i < activeComponents.size(); i++)
+        {
+            activeComponents[i]->commandOrder = static_cast<int>(i);
+        }
+        
+        NativeComponentDB::PrepareCommandBuffers();
+        
+        // One component per job, a single component can have a lot of work to do
+        JobSystem::ParallelFor(static_cast<int>(activeComponents.size()), 1, [&activeComponents](int start, int end)
+        {
+            NativeCommandBuffer& buffer = NativeComponentDB::GetCommandBuffer();
+            for (int i = start; i < end; i++)
+            {
+                (activeComponents[i]->*parallelFunction)(buffer);
+            }
+        });
+        
+        NativeComponentDB::ApplyCommands();
+    }
+    
+    static luabridge::LuaRef Create() {return luabridge::LuaRef(luaState, Allocate(nullptr));}
+    static luabridge::LuaRef Copy(const luabridge::LuaRef& source) {return luabridge::LuaRef(luaState, Allocate(source.cast<T*>()));}
+    static void Reset(const luabridge::LuaRef& component, const luabridge::LuaRef& source) {*component.cast<T*>() = *source.cast<T*>();}
+    static void Release(const luabridge::LuaRef& component) {Release(component.cast<T*>());}
+    static NativeComponent* GetBase(const luabridge::LuaRef& component) {return component.cast<T*>();}
+    
+    static inline lua_State* luaState = nullptr;
+
+private:
+    struct Storage
+    {
+        // A deque so components never move, Lua and the engine hold pointers to them
+        std::deque<T> components;
+        std::vector<uint8_t> inUse;
+        std::vector<T*> freeComponents;
+        
+        // The components a parallel update is running on, kept to reuse its memory
+        std::vector<T*> activeComponents;
+    };
+    
+    // Never freed, so components can still be released while the program exits
+    static Storage& GetStorage()
+    {
+        static Storage* storage = new Storage();
+        return *storage;
+    }
+    
+    // What new components are reset to when they reuse a released one
+    static const T& GetPrototype()
+    {
+        static const T* prototype = new T();
+        return *prototype;
+    }
+};
+
+// Declares a C++ component type, each field is bound to Lua and can be set from JSON.
+// The values every C++ component has are declared for it.
+template <class T>
+class NativeComponentDeclaration
+{
+public:
+    NativeComponentDeclaration(lua_State* luaState, const std::string& name)
+        : bindings(luabridge::getGlobalNamespace(luaState).beginClass<T>(name.c_str()))
+    {
+        NativeComponentPool<T>::luaState = luaState;
+        
+        type.name = name;
+        type.create = &NativeComponentPool<T>::Create;
+        type.copy = &NativeComponentPool<T>::Copy;
+        type.reset = &NativeComponentPool<T>::Reset;
+        type.release = static_cast<void (*)(const luabridge::LuaRef&)>(&NativeComponentPool<T>::Release);
+        type.getBase = &NativeComponentPool<T>::GetBase;
+        
+        bindings.addData("type", static_cast<std::string T::*>(&NativeComponent::type));
+        bindings.addData("key", static_cast<std::string T::*>(&NativeComponent::key));
+        bindings.addProperty("actor", static_cast<ActorRef (T::*)() const>(&NativeComponent::GetActor));
+        bindings.addData("started", static_cast<bool T::*>(&NativeComponent::started));
+        Field("enabled", static_cast<bool T::*>(&NativeComponent::enabled));
+    }
+    
+    // A member Lua can read and write, and JSON can set
+    template <class U>
+    NativeComponentDeclaration& Field(const char* name, U T::* member)
+    {
+        bindings.addData(name, member);
+        type.loaders[name] = [member](NativeComponent* component, const rapidjson::Value& value)
+        {
+            NativeComponentDB::ReadJson(value, static_cast<T*>(component)->*member);
+        };
+        return *this;
+    }
+    
+    // A value Lua reads and writes through functions, JSON sets it through the setter
+    template <class U>
+    NativeComponentDeclaration& Property(const char* name, U (T::*getter)() const, void (T::*setter)(U))
+    {
+        bindings.addProperty(name, getter, setter);
+        type.loaders[name] = [setter](NativeComponent* component, const rapidjson::Value& value)
+        {
+            U property;
+            if (NativeComponentDB::ReadJson(value, property))
+            {
+                (static_cast<T*>(component)->*setter)(property);
+            }
+        };
+        return *this;
+    }
+    
+    // A member function Lua can call, lifecycle functions are found by their names like on Lua components
+    template <class F>
+    NativeComponentDeclaration& Function(const char* name, F function)
+    {
+        bindings.addFunction(name, function);
+        return *this;
+    }
+    
+    // Updates every component of the type in one loop instead of calling OnUpdate through Lua on each one, when updates are grouped by type
+    NativeComponentDeclaration& BatchUpdate(void (T::*function)())
+    {
+        NativeComponentPool<T>::batchFunction = function;
+        type.batchUpdate = &NativeComponentPool<T>::UpdateAll;
+        return *this;
+    }
+    
+    // Updates every component of the type across the job system. The function can run on any thread,
+    // so it may only change its own component and has to record anything else (Box2D, drawing) into the buffer
+    NativeComponentDeclaration& ParallelUpdate(void (T::*function)(NativeCommandBuffer& buffer))
+    {
+        NativeComponentPool<T>::parallelFunction = function;
+        type.batchUpdate = &NativeComponentPool<T>::UpdateAllParallel;
+        return *this;
+    }
+    
+    // Finishes the Lua bindings and adds the type
+    void End()
+    {
+        bindings.endClass();
+        NativeComponentDB::AddType(type);
+    }
+
+private:
+    // LuaBridge keeps its class builder private, so its type is taken from what beginClass returns
+    decltype(std::declval<luabridge::Namespace>().beginClass<T>("")) bindings;
+    NativeComponentType type;
+};
+
+// Starts declaring a C++ component type, End() adds it
+template <class T>
+NativeComponentDeclaration<T> NativeComponentDB::Declare(lua_State* luaState, const std::string& name)
+{
+    return NativeComponentDeclaration<T>(luaState, name);
+}
+
+#endif /* NativeComponentDB_h */
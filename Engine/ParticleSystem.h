@@ -15,6 +15,7 @@
 #include "PhysicsHandler.h"
 #include "Renderer.h"
 #include "Application.h"
+#include "JobSystem.h"
 
 using namespace std;
 
@@ -30,22 +31,19 @@ struct Particle
     float color[4] = {255.0f, 255.0f, 255.0f, 255.0f};
     int former_color_index = 0; // The index of the color that this particle is transitioning away from.
     int future_color_index = 1; // The index of the color that this particle is transitioning to.
+    b2Vec2 velocity = b2Vec2(0.0f, 0.0f); // The velocity worked out by the movement pattern this frame.
 };
 
-class ParticleSystem
+class ParticleSystem : public NativeComponent
 {
 public:
+    ParticleSystem() : NativeComponent("ParticleSystem") {}
+    
     int MAX_NUM_PARTICLES = 10000;
     int num_particles = 0;
-    int framesActive = 0; // The number of frames that this system has been emitting for.
-    std::queue<Particle*> particles;
-    
-    // Base component values
-    std::string type = "ParticleSystem";
-    std::string key = "???";
-    Actor* actor = nullptr;
-    bool enabled = true;
-    bool started = false;
+    float timeActive = 0.0f; // The number of seconds that this system has been emitting for.
+    float emissionTimer = 0.0f; // Seconds of emission that haven't produced a particle yet.
+    std::vector<Particle*> particles;
     
     // Emitter parameters
     bool emitting = true;
@@ -109,20 +107,37 @@ public:
     // Chaches the fixtures at a bunch of different sizes so that we don't have to keep making new ones and leaking memory by making new shapes.
     std::unordered_map<int, b2FixtureDef*> colliders_by_size;
     
+    // How wide the sprite is in world units, measured on the main thread every frame before any particles are drawn
+    float imageWidthInUnits = 0.0f;
+    
     // Particle System functions
     void StartEmitting();
     void StopEmitting();
     void CreateParticle();
     void UpdateParticle(Particle* particle);
+    void ApplyParticleToBody(Particle* particle);
     std::vector<float> GetDeltaColor(Particle* particle);
     b2FixtureDef* GetNewCollider(float size);
     void DestroyParticle(Particle* particle);
-    void RenderParticle(Particle* particle);
+    void RenderParticle(Particle* particle, b2Vec2 position, float rotation);
+    void EmitParticles(int count);
     
     // Standard lifecycle functions
     void OnStart();
     void OnUpdate();
     void OnDestroy();
+    
+    // OnUpdate without anything that touches Box2D, the renderer or random numbers, those are recorded into buffer.
+    // Only changes this system, so every system can be updated at once on the job system
+    void UpdateParallel(NativeCommandBuffer& buffer);
+    
+private:
+    // Commands recorded by UpdateParallel, applied on the main thread
+    static void ApplyMeasureImage(NativeCommand& command);
+    static void ApplyParticleBody(NativeCommand& command);
+    static void ApplyRenderParticle(NativeCommand& command);
+    static void ApplyDestroyParticle(NativeCommand& command);
+    static void ApplyEmitParticles(NativeCommand& command);
 };
 
 // Enforces colors being sorted by their given percentage
@@ -13,6 +13,7 @@
 #include <string>
 #include <math.h>
 #include <unordered_set>
+#include <unordered_map>
 #include <map>
 
 #include "Box2D/box2d.h"
@@ -21,13 +22,19 @@
 #include "lua.hpp"
 #include "LuaBridge.h"
 
+#include "ComponentRecord.h"
+#include "ActorSlotMap.h"
+#include "ActorRef.h"
+#include "NativeComponentDB.h"
+
 using namespace std;
 
 class Actor;
+class Transform;
 
 struct Collision
 {
-    Actor* other;
+    ActorRef other;
     b2Vec2 point;
     b2Vec2 relative_velocity;
     b2Vec2 normal;
@@ -35,12 +42,36 @@ struct Collision
 
 struct HitResult
 {
-    Actor* actor;
+    ActorRef actor;
     b2Vec2 point;
     b2Vec2 normal;
     bool is_trigger;
 };
 
+// A contact between two actors found during a physics step.
+// They are called once the step is done, since the world can't be changed in the middle of one.
+struct ContactEvent
+{
+    // OnCollisionEnter, OnCollisionExit, OnTriggerEnter or OnTriggerExit
+    LifecycleFunction function;
+    
+    Actor* actorA;
+    Actor* actorB;
+    ActorHandle handleA;
+    ActorHandle handleB;
+    
+    b2Vec2 point;
+    b2Vec2 normal;
+    b2Vec2 relativeVelocity;
+};
+
+// Where a body was at the end of a physics step
+struct BodyPose
+{
+    b2Vec2 position;
+    float angle;
+};
+
 class ContactListener : public b2ContactListener
 {
 public:
@@ -70,15 +101,10 @@ public:
     static luabridge::LuaRef RaycastAll(b2Vec2 pos, b2Vec2 dir, float dist);
 };
 
-class Rigidbody
+class Rigidbody : public NativeComponent
 {
 public:
-    // Base component values
-    std::string type = "Rigidbody";
-    std::string key = "???";
-    Actor* actor = nullptr;
-    bool enabled = true;
-    bool started = false;
+    Rigidbody() : NativeComponent("Rigidbody") {}
     
     // Rigidbody values
     float x = 0.0f;
@@ -108,6 +134,10 @@ public:
     
     b2Body* body = nullptr;
     
+    // The Transform on the same actor when the body was made, it starts the body where it is and follows the body after.
+    // The Transform sets this back to nullptr if it is removed first
+    Transform* transform = nullptr;
+    
     // Functions
     void AddForce(b2Vec2 force);
     
@@ -129,6 +159,10 @@ public:
     b2Vec2 GetUpDirection();
     b2Vec2 GetRightDirection();
     
+    // Getters that blend between the last two fixed ticks, use these when drawing
+    b2Vec2 GetInterpolatedPosition();
+    float GetInterpolatedRotation();
+    
     void OnStart();
     void OnDestroy();
 };
@@ -145,8 +179,22 @@ public:
     // Initializes the physics world
     static void Init();
     
-    // Steps forwards in the physics engine by one frame
-    static void Step();
+    // Steps forwards in the physics engine by one fixed tick
+    static void Step(float timeStep);
+    
+    // Contacts found since they were last dispatched
+    static inline std::vector<ContactEvent> contactEvents;
+    
+    // Calls the contact functions for every contact found since the last dispatch
+    static void DispatchContacts();
+    
+    // Gets a bodies position/angle blended between the previous and current tick by the TimeHandler's alpha
+    static b2Vec2 GetInterpolatedPosition(b2Body* body);
+    static float GetInterpolatedAngle(b2Body* body);
+    
+private:
+    // Where every body was before the most recent step
+    static inline std::unordered_map<b2Body*, BodyPose> previousTransforms;
 };
 
 #endif /* PhysicsHandler_h */
@@ -0,0 +1,100 @@
+//
+//  Profiler.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/6/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+#include "SDL2/SDL.h"
+
+#include "EngineUtils.h"
+
+// One timed section of a frame
+struct ProfileEvent
+{
+    const char* name = nullptr;
+    Uint64 start = 0;
+    Uint64 end = 0;
+    int threadID = 0;
+
+    // Counters are a single value at a point in time instead of a section
+    bool counter = false;
+    double value = 0.0;
+
+    // Incremented once the event has been completely written, so a reader can skip slots that are mid-write
+    std::atomic<uint64_t> sequence{0};
+};
+
+// Records how long each phase of a frame takes into a ring buffer that can be written out as a
+// Chrome trace (open it in chrome://tracing or ui.perfetto.dev).
+// Turn it on with "profiler": true in game.config or by setting the PROFILER environment variable.
+class Profiler
+{
+public:
+    // Whether timers record anything at all
+    static bool enabled;
+
+    // Where the trace is written when the game exits
+    static std::string tracePath;
+
+    // Reads the profiler settings and registers the trace to be written at exit
+    static void Init();
+
+    // Adds a finished section to the ring buffer, safe to call from any thread
+    static void Record(const char* name, Uint64 start, Uint64 end);
+
+    // Adds the value a counter had at this moment, shown as a graph in the trace
+    static void RecordCounter(const char* name, double value);
+
+    // Writes every event still in the ring buffer to a Chrome trace_event JSON file
+    static void WriteTrace(std::string path);
+
+private:
+    // The number of events kept, older events get overwritten (must be a power of 2)
+    static const int BUFFER_SIZE = 1 << 16;
+
+    static ProfileEvent events[BUFFER_SIZE];
+    static std::atomic<uint64_t> writeIndex;
+
+    // Gives every thread that records an event a small ID for the trace
+    static int GetThreadID();
+
+    // Called by atexit so traces get written no matter how the game quits
+    static void WriteTraceAtExit();
+};
+
+// Times the scope it's declared in
+class ScopedTimer
+{
+public:
+    ScopedTimer(const char* name) : name(name)
+    {
+        if (Profiler::enabled) {start = SDL_GetPerformanceCounter();}
+    }
+
+    ~ScopedTimer()
+    {
+        if (Profiler::enabled && start != 0) {Profiler::Record(name, start, SDL_GetPerformanceCounter());}
+    }
+
+private:
+    const char* name;
+    Uint64 start = 0;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Times everything from here to the end of the enclosing scope under the given name
+#define PROFILE_SCOPE(name) ScopedTimer PROFILE_CONCAT(profileTimer, __LINE__)(name)
+
+#endif /* Profiler_h */
@@ -10,13 +10,16 @@
 #ifndef Renderer_h
 #define Renderer_h
 
-#include <queue>
+#include <vector>
 
 #include "SDL2_image/SDL_image.h"
 #include "SDL2/SDL.h"
 #include "Helper.h"
 #include "ImageDB.h"
 #include "EngineUtils.h"
+#include "JobSystem.h"
+#include "Camera.h"
+#include "Transform.h"
 
 struct Text
 {
@@ -56,20 +59,58 @@ struct Pixel
     SDL_Color color;
 };
 
+// Everything SDL needs to draw one image, worked out ahead of time so it can be built off the main thread
+struct DrawCommand
+{
+    SDL_Texture* texture = nullptr;
+    bool imageFound = false;
+    
+    SDL_Rect rect;
+    SDL_Point center;
+    int rotationDegrees;
+    int flip;
+    
+    SDL_Color color;
+};
+
+// Sorts images into the order they should be drawn in (lowest sorting order first, then in the order they were requested)
 struct ImageOrderComparator
 {
     // Comparator function
-    bool operator()(Image A, Image B)
+    bool operator()(const Image& A, const Image& B) const
     {
         if (A.sortingOrder == B.sortingOrder) 
         {
-            return A.requestOrder > B.requestOrder;
+            return A.requestOrder < B.requestOrder;
         }
         
-        return A.sortingOrder > B.sortingOrder;
+        return A.sortingOrder < B.sortingOrder;
     }
 };
 
+// Everything drawn during one frame.
+// There are two of these so one can be recorded by the scripts while the other is built and submitted.
+struct RenderFrame
+{
+    std::vector<Image> sceneImages;
+    std::vector<Image> UIImages;
+    std::vector<Text> texts;
+    std::vector<Pixel> pixels;
+    
+    // The camera as it was when this frame finished recording
+    Camera camera;
+    
+    // The draw commands for sceneImages and UIImages, in the same (sorted) order
+    std::vector<DrawCommand> sceneCommands;
+    std::vector<DrawCommand> UICommands;
+    
+    // True once the draw commands have been built and the frame can be submitted
+    bool readyToSubmit = false;
+    
+    // Empties the frame so it can be recorded into again (keeps the memory around)
+    void Clear();
+};
+
 class Renderer
 {
 public:
@@ -95,6 +136,13 @@ public:
     // Show Gizmos (Debug tools such as viewing box collders)
     static bool show_gizmos;
     
+    // The total number of images, text and pixels that have been submitted to be drawn
+    static long long drawCallsSubmitted;
+    
+    // Builds each frame's draw list on a worker while the next frame's scripts run, and submits it at the end of that frame.
+    // Adds one frame of latency, so it's off by default (and always off for the autograder)
+    static bool pipelined;
+    
     // Initializes the window and renderer
     static void RenderStart();
     
@@ -113,28 +161,51 @@ public:
     // Draws a scene space image with some extra parameters
     static void DrawEx(std::string imageName, float x, float y, float rotationDegrees, float scaleX, float scaleY, float pivotX, float pivotY, float r, float g, float b, float a, float sortingOrder);
     
+    // Draws a scene space image where a transform is in the world, with its world rotation and scale
+    static void DrawTransform(std::string imageName, Transform* transform, float sortingOrder);
+    
     // Draws a pixel on the screen
     static void DrawPixel(float x, float y, float r, float g, float b, float a);
     
     // Renders all of the needed text and images in proper order
     static void Render();
 private:
-    static inline std::priority_queue<Image, std::vector<Image>, ImageOrderComparator> sceneImagesToDraw;
-    static inline std::priority_queue<Image, std::vector<Image>, ImageOrderComparator> UIImagesToDraw;
-    static inline std::queue<Text> textToDraw;
-    static inline std::queue<Pixel> pixelsToDraw;
+    // The frame being recorded into is frames[recordingFrame], the other one is being built or waiting to be submitted
+    static inline RenderFrame frames[2];
+    static inline int recordingFrame = 0;
+    
+    // Counts the build job of the last recorded frame when pipelined
+    static inline JobCounter buildCounter;
+    
+    // Sorts a recorded frame and works out all of its draw commands, doesn't touch SDL so it can run on a worker
+    static void BuildFrame(RenderFrame& frame);
+    
+    // Sends a built frame to SDL, has to run on the main thread
+    static void SubmitFrame(RenderFrame& frame);
+    
+    // Draws all the text in the frame to the window
+    static void RenderText(RenderFrame& frame);
+    
+    // Draws all the scene space images in the frame to the window
+    static void RenderSceneSpaceImages(RenderFrame& frame);
+    
+    // Draws all the UI images in the frame to the window
+    static void RenderUIImages(RenderFrame& frame);
+    
+    // Draws all the pixels in the frame to the window
+    static void RenderPixels(RenderFrame& frame);
     
-    // Draws all the text in the textToDraw queue to the window
-    static void RenderText();
+    // Works out the draw command for every image across the job system
+    static void BuildDrawCommands(const std::vector<Image>& images, std::vector<DrawCommand>& commands, const Camera* camera);
     
-    // Draws all the images in the sceneImagesToDraw queue to the window
-    static void RenderSceneSpaceImages();
+    // Works out where a scene space image lands on the screen
+    static DrawCommand BuildSceneDrawCommand(const Image& i, const Camera& camera);
     
-    // Draws all the images in the UIImagesToDraw queue to the window
-    static void RenderUIImages();
+    // Works out where a UI image lands on the screen
+    static DrawCommand BuildUIDrawCommand(const Image& i);
     
-    // Draws all the pixels in the pixelsToDraw queue to the window
-    static void RenderPixels();
+    // Sends the built draw commands to SDL in order, has to run on the main thread
+    static void SubmitDrawCommands(const std::vector<Image>& images, const std::vector<DrawCommand>& commands);
     
     // Returns true if the given rect is viewable by the camera
     static bool IsImageInCamera(float x, float y, float w, float h);
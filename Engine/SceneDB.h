@@ -33,10 +33,39 @@
 #include "AudioDB.h"
 #include "Camera.h"
 #include "Actor.h"
+#include "ActorSlotMap.h"
+#include "ActorRef.h"
 #include "Renderer.h"
 #include "glm/glm.hpp" // Student : You need to get glm added to your project source code or this line will fail.
 #include  "glm/gtx/hash.hpp"
 
+// One component in one of the scene's update lists
+struct DispatchEntry
+{
+    Actor* actor;
+    std::shared_ptr<ComponentRecord> component;
+    
+    // Copied out of the actor and component so sorting doesn't have to follow pointers
+    int typeIndex;
+    int actorID;
+    long long initOrder;
+    
+    // Time passed since the component's last OnUpdate, handed to it when its update policy lets it run
+    float accumulatedTime = 0.0f;
+};
+
+// Every component in the scene that has one of the lifecycle functions
+struct DispatchList
+{
+    LifecycleFunction function;
+    std::vector<DispatchEntry> entries;
+    
+    // Entries past this were added since the list was last sorted
+    size_t sortedCount = 0;
+    
+    DispatchList(LifecycleFunction function) : function(function) {}
+};
+
 class Scene
 {
 public:
@@ -48,13 +77,13 @@ public:
     Camera camera;
     
     // A list of actors in the scene, in the order that they were loaded
-    std::map<int, std::shared_ptr<Actor>> actors;
+    ActorSlotMap actors;
     
     // A list of actors that need to be added to the scene this frame
     std::vector<std::shared_ptr<Actor>> actorsToAdd;
     
-    // A list of actors UUIDs that need to be removed from the scene this frame
-    std::vector<int> actorsToDestroy;
+    // The actors destroyed this frame, they are removed from the scene at the end of it
+    std::vector<Actor*> actorsToDestroy;
 
     // Actors to not destroy when a new scene is loaded
     std::vector<std::shared_ptr<Actor>> immortalActors;
@@ -62,12 +91,40 @@ public:
     // Update all of the actors in this scene
     void UpdateActors();
     
+    // Runs one fixed simulation tick on all of the actors in this scene
+    void FixedUpdateActors();
+    
     // Adds a new actor into this scene and returns a reference to it.
     Actor* AddNewActor(std::string actor_template_name);
     
+    // Adds count new actors made from the same template into this scene and appends them to newActors.
+    // The template is looked up and the scene's storage is grown once for the whole batch.
+    void AddNewActors(std::string actor_template_name, int count, std::vector<Actor*>& newActors);
+    
     // To be called when this scene is loaded into the current scene
     void Init();
     
+    // Actors in the scene or being added to it, by name and by tag, in the order Find returns them.
+    // Names are in the order actors were added (which is ID order), tags in the order they were tagged.
+    std::unordered_map<std::string, std::vector<Actor*>> actorsByName;
+    std::unordered_map<std::string, std::vector<Actor*>> actorsByTag;
+    
+    // Adds an actor to the name and tag indices
+    void AddToIndex(Actor* actor);
+    
+    // Removes destroyed actors from the name and tag indices, each list they were in is only gone through once
+    void RemoveFromIndex(const std::vector<std::shared_ptr<Actor>>& destroyedActors);
+    
+    // Keeps the tag index up to date when tags change at runtime
+    void AddTagToIndex(Actor* actor, const std::string& tag);
+    void RemoveTagFromIndex(Actor* actor, const std::string& tag);
+    
+    // Marks an actor as having components to initialize, start or remove.
+    // Each frame the scene only goes through the actors marked for each step.
+    void QueueNewComponents(Actor* actor);
+    void QueueAddedComponents(Actor* actor);
+    void QueueRemovedComponents(Actor* actor);
+    
     // Constructs a new scene from a .scene file
     Scene(rapidjson::Document *sceneDocument);
     
@@ -77,6 +134,70 @@ public:
 private:
     // The memory location of all the default actors in the scene
     std::vector<Actor> defaultActors;
+    
+    // The scene calls lifecycle functions from these instead of going through every actor,
+    // so actors with nothing to update cost nothing
+    DispatchList updateList = {ON_UPDATE};
+    DispatchList fixedUpdateList = {ON_FIXED_UPDATE};
+    DispatchList lateUpdateList = {ON_LATE_UPDATE};
+    
+    // Set when components were removed this frame and the lists need to drop them
+    bool dispatchListsDirty = false;
+    
+    // The actors with components added at runtime that haven't been initialized, with components that haven't started,
+    // and with components removed (or that were destroyed) this frame
+    std::vector<Actor*> actorsWithNewComponents;
+    std::vector<Actor*> actorsWithAddedComponents;
+    std::vector<Actor*> actorsWithRemovedComponents;
+    
+    // Reused by the destroy pass so destroying actors doesn't allocate these every frame
+    std::vector<std::shared_ptr<Actor>> destroyedActors;
+    std::vector<ActorHandle> destroyedHandles;
+    std::vector<std::vector<Actor*>*> indexListsToCompact;
+    
+    // Removes the actors destroyed this frame from every list the scene keeps them in
+    void DestroyActors();
+    
+    // Starts the components added to the actors queued for it, actors with components that are still disabled stay queued
+    void ProcessAddedComponents();
+    
+    // Initializes the components added at runtime to the actors queued for it
+    void InitNewComponents();
+    
+    // Removes the components removed from the actors queued for it, returns true if any were removed
+    bool ProcessRemovedComponents();
+    
+    // Adds the components to the end of the update lists they have lifecycle functions for
+    void AddToDispatchLists(Actor* actor, const std::vector<std::shared_ptr<ComponentRecord>>& components);
+    
+    // Adds the components the actor initialized since the last time this was called
+    void AddNewComponentsToDispatchLists(Actor* actor);
+    
+    // Sorts the entries added to the update lists into place
+    void SortDispatchLists();
+    
+    // Drops removed components and destroyed actors from the update lists
+    void CleanDispatchLists();
+    
+    // Calls the list's lifecycle function on every enabled and started component in it
+    void Dispatch(const DispatchList& list);
+    
+    // Calls OnUpdate on every enabled and started component whose update policy lets it run this frame,
+    // along with the time since its last update
+    void DispatchUpdate(DispatchList& list);
+    
+    // Returns true if a throttled component should be updated this frame.
+    // Ticks are staggered by actor ID so components on the same interval don't all run on the same frame
+    bool IsUpdateDue(const DispatchEntry& entry, int frame);
+    
+    // How far the actor is outside the camera's view in world units, 0 if it is in view or has no position
+    float GetDistanceOffCamera(Actor* actor, int frame);
+    
+    // The order components are called in, by type then actor if updates are grouped by type
+    static bool DispatchOrder(const DispatchEntry& a, const DispatchEntry& b);
+    
+    // Adds a new actor made from a compiled template, reusing a pooled one if there is one
+    Actor* AddNewActor(const ActorBlueprint& blueprint);
 };
 
 class SceneDB
@@ -88,6 +209,12 @@ public:
     // The current scene that the game is in
     static Scene currentScene;
     
+    // If true every component of a type is updated back to back, otherwise every actor's components are updated together
+    static bool groupUpdatesByType;
+    
+    // How far outside the camera's view (in world units) an actor still counts as on camera for update policies
+    static float updateLODMargin;
+    
     // Stores if loading a new scene is needed and what the name of the scene is
     static std::string nextScene;
     static bool loadNewScene;
@@ -102,7 +229,7 @@ public:
     static void LoadNewScene();
     
     // Makes it so the given actor persists throughout scene loads
-    static void DontDestroy(Actor* actor);
+    static void DontDestroy(ActorRef actor);
     
     // Gets the name of the current scene
     static std::string GetCurrentSceneName();
@@ -112,19 +239,29 @@ public:
     
     // Finds an actor in the currentScene that has the provided name
     // If multiple actors have this name this returns the one that was loaded first
-    static Actor* FindActorWithName(std::string actor_name);
+    static ActorRef FindActorWithName(std::string actor_name);
     
     // Finds all actors in the currentScene that have the provided name
     static luabridge::LuaRef FindAllActorsWithName(std::string actor_name);
     
+    // Finds an actor in the currentScene that has the provided tag
+    // If multiple actors have this tag this returns the one that was tagged first
+    static ActorRef FindActorWithTag(std::string tag);
+    
+    // Finds all actors in the currentScene that have the provided tag
+    static luabridge::LuaRef FindAllActorsWithTag(std::string tag);
+    
     // Finds an actor with the given UUID
     static std::shared_ptr<Actor> FindActorByID(int ID);
     
     // Creates a new actor and adds it to the current scene, then returns a reference to it
-    static Actor* Instantiate(std::string actor_template_name);
+    static ActorRef Instantiate(std::string actor_template_name);
     
-    // Destroys an actor and removes it from the sccene
-    static void Destroy(Actor* actor);
+    // Creates count actors from the same template and adds them to the current scene, then returns them in a Lua array
+    static luabridge::LuaRef InstantiateMany(std::string actor_template_name, int count);
+    
+    // Destroys an actor and removes it from the sccene, does nothing if it's already gone
+    static void Destroy(ActorRef actor);
     
     // Sets camera position
     static void CameraSetPosition(float x, float y);
@@ -140,6 +277,9 @@ public:
     static float GetZoom();
 private:
     static inline std::unordered_map<std::string, Scene> loadedScenes;
+    
+    // Marks an actor in the current scene as destroyed and queues its components to be removed
+    static void DestroyActor(Actor* actor);
 };
 
 #endif /* SceneDB_h */
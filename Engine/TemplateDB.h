@@ -26,17 +26,43 @@
 #include "Actor.h"
 #include "glm/glm.hpp" // Student : You need to get glm added to your project source code or this line will fail.
 
+// A component of a compiled template
+struct ComponentBlueprint
+{
+    // The template's own component, clones inherit from it or copy it if it is C++ based
+    std::shared_ptr<ComponentRecord> source;
+    bool isCPP = false;
+};
+
+// A template compiled once when it is loaded, actors are cloned from it without copying the template or looking anything up by name
+struct ActorBlueprint
+{
+    std::string templateName;
+    
+    // The actor loaded from the template file, its components already have the file's property overrides and their lifecycle functions resolved
+    Actor templateActor;
+    
+    // The template's components in key order
+    std::vector<ComponentBlueprint> components;
+};
+
 class TemplateDB
 {
 public:
-    // Loads all of the templates in the resources/actor_templates directory into loadedTemplates
+    // Loads all of the templates in the resources/actor_templates directory into blueprints
     static void LoadTemplates();
 
-    // Get an actor template from loadedTemplates based on the templates name
-    static Actor GetTemplate(std::string templateName);
+    // Get a compiled template from blueprints based on the templates name
+    static const ActorBlueprint& GetBlueprint(const std::string& templateName);
+    
+    // Returns the loaded template with the given name without copying it, or nullptr if there isn't one
+    static const Actor* FindTemplate(const std::string& templateName);
     
 private:
-    static inline std::unordered_map<std::string, Actor> loadedTemplates;
+    static inline std::unordered_map<std::string, ActorBlueprint> blueprints;
+    
+    // Works out everything cloning a loaded template needs ahead of time
+    static void Compile(ActorBlueprint& blueprint);
 };
 
 #endif /* TemplateDB_h */
@@ -0,0 +1,69 @@
+//
+//  TimeHandler.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/2/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef TimeHandler_h
+#define TimeHandler_h
+
+#include <stdio.h>
+
+#include "SDL2/SDL.h"
+
+#include "EngineUtils.h"
+
+// Keeps track of real frame time and schedules the fixed simulation ticks.
+// The simulation (OnFixedUpdate and physics) always advances by fixedDeltaTime,
+// while rendering runs as often as frames are presented and interpolates between ticks.
+class TimeHandler
+{
+public:
+    // The number of fixed simulation ticks per second
+    static int tickRate;
+
+    // The most fixed ticks that will run in one frame before the simulation stops trying to catch up
+    static int maxSubsteps;
+
+    // The length of one fixed tick in seconds
+    static float fixedDeltaTime;
+
+    // The number of real seconds that passed between the start of the last frame and this one
+    static float deltaTime;
+
+    // How far the current frame is between the previous fixed tick and the next one (0 - 1)
+    static float alpha;
+
+    // The total number of simulated seconds since the game started
+    static double time;
+
+    // Reads the tick settings out of game.config
+    static void Init();
+
+    // Measures how long the last frame took and adds it to the accumulator
+    static void BeginFrame();
+
+    // Returns true if another fixed tick should run this frame
+    static bool ShouldRunFixedStep();
+
+    // Lua getters
+    static float GetDeltaTime() {return deltaTime;}
+    static float GetFixedDeltaTime() {return fixedDeltaTime;}
+    static float GetInterpolationAlpha() {return alpha;}
+    static float GetTime() {return static_cast<float>(time);}
+
+private:
+    // The performance counter value at the start of the last frame
+    static Uint64 lastFrameCounter;
+
+    // Real time that has passed but hasn't been simulated yet
+    static double accumulator;
+
+    // The number of fixed ticks that have run during the current frame
+    static int substepsThisFrame;
+};
+
+#endif /* TimeHandler_h */
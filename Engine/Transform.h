@@ -0,0 +1,139 @@
+//
+//  Transform.h
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/17/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#ifndef Transform_h
+#define Transform_h
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Box2D/box2d.h"
+#include "NativeComponentDB.h"
+
+class Actor;
+class Transform;
+
+// Holds the data of every Transform in structure-of-arrays pools, each Transform owns one slot in them.
+// World values are worked out for every transform at once by UpdateWorldTransforms.
+class TransformHandler
+{
+public:
+    // Position, rotation (degrees clockwise) and scale, relative to the parent if there is one
+    static inline std::vector<float> localX;
+    static inline std::vector<float> localY;
+    static inline std::vector<float> localRotation;
+    static inline std::vector<float> localScaleX;
+    static inline std::vector<float> localScaleY;
+    
+    // The same values in world space, as of the last time they were worked out
+    static inline std::vector<float> worldX;
+    static inline std::vector<float> worldY;
+    static inline std::vector<float> worldRotation;
+    static inline std::vector<float> worldScaleX;
+    static inline std::vector<float> worldScaleY;
+    
+    // The slot of each transform's parent, -1 if it doesn't have one
+    static inline std::vector<int> parents;
+    
+    // Set when a transform's local values change, its world values (and its children's) are out of date until the next update
+    static inline std::vector<uint8_t> dirty;
+    
+    // The body a transform follows, set by a Rigidbody on the same actor. Its pose is in world space
+    static inline std::vector<b2Body*> bodies;
+    
+    // The Transform that owns each slot, nullptr for free slots
+    static inline std::vector<Transform*> owners;
+    
+    // Gives a Transform a slot with default values
+    static int Allocate(Transform* owner);
+    
+    // Frees a slot, its children keep where they are in the world and lose their parent
+    static void Free(int slot);
+    
+    // Parents one slot to another, -1 removes its parent. Returns false if it would make a loop
+    static bool SetParent(int slot, int parent);
+    
+    // Makes sure a slot's world values are up to date, returns true if they had to be worked out again
+    static bool ResolveWorld(int slot);
+    
+    // Works out the world values of every transform, roots first then children after their parents
+    static void UpdateWorldTransforms();
+    
+private:
+    static inline std::vector<int> freeSlots;
+    
+    // How many children each slot has, so freeing one without children doesn't have to look for them
+    static inline std::vector<int> childCounts;
+    
+    // Every transform with a parent, ordered so parents come before their children
+    static inline std::vector<int> childOrder;
+    static inline bool hierarchyChanged = false;
+    
+    // Works out a slot's world values from its parent's
+    static void ComputeWorld(int slot);
+    
+    // Sets a slot's local values so it ends up at its body's world pose, undoing its parent's world transform if it has one
+    static void FollowBody(int slot);
+    
+    // Sorts the transforms with parents by how deep they are in their hierarchy
+    static void RebuildChildOrder();
+};
+
+// A built-in component for where an actor is, its values live in TransformHandler's pools
+class Transform : public NativeComponent
+{
+public:
+    Transform();
+    Transform(const Transform& other);
+    Transform& operator=(const Transform& other);
+    ~Transform();
+    
+    // Local values, these are what the component's JSON sets
+    float GetX() const;
+    float GetY() const;
+    float GetRotation() const;
+    float GetScaleX() const;
+    float GetScaleY() const;
+    void SetX(float x);
+    void SetY(float y);
+    void SetRotation(float degrees_clockwise);
+    void SetScaleX(float scale_x);
+    void SetScaleY(float scale_y);
+    
+    b2Vec2 GetPosition();
+    void SetPosition(b2Vec2 position);
+    
+    // World values, worked out on the spot if anything changed since the last update
+    b2Vec2 GetWorldPosition();
+    float GetWorldRotation();
+    b2Vec2 GetWorldScale();
+    
+    // Parenting, nil removes the parent. The local values are kept and become relative to the new parent
+    void SetParent(Transform* parent);
+    Transform* GetParent();
+    
+    // Makes this transform follow a body, which is moved along with it when it is set from Lua
+    void AttachBody(b2Body* body);
+    void DetachBody();
+    
+    // This transform's slot in TransformHandler, -1 once it has been destroyed
+    int GetSlot() const {return slot;}
+    
+    void OnDestroy();
+    
+private:
+    int slot = -1;
+    
+    // Moves the attached body to where the world values say it should be, bodies don't know about parents
+    void MoveBody();
+};
+
+#endif /* Transform_h */
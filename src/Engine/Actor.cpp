@@ -8,13 +8,17 @@
 //  School Email: mrjacob@umich.edu
 
 #include <stdio.h>
+#include <algorithm>
 
 #include "Actor.h"
 #include "SceneDB.h"
 #include "ParticleSystem.h"
+#include "Transform.h"
+#include "CoroutineScheduler.h"
 
 // ActorDB class
 int ActorDB::numAddedComponents = 0;
+long long ActorDB::numInitializedComponents = 0;
 
 // Actor class
 // Called the frame an actor is loaded
@@ -30,349 +34,201 @@ void Actor::ProcessAddedComponents()
 {
     // Don't update this Actor if it isn't enabled
     if (enabled == false) {return;};
-    std::vector<std::string> processed;
     
-    for (auto& component : componentsToAdd)
+    auto component = componentsToAdd.begin();
+    while (component != componentsToAdd.end())
     {
+        ComponentRecord& record = *component->second;
+        
         // Don't start this component if it isn't enabled
-        if ((*component.second)["enabled"] == false) {continue;};
+        if (*record.enabled == false)
+        {
+            component++;
+            continue;
+        }
         
         // Mark this component as processed
-        (*component.second)["started"] = true;
-        processed.push_back(component.first);
+        record.SetStarted(true);
         
-        try
+        // Components added during another component's "OnStart" haven't been initialized yet
+        record.ResolveFunctions();
+        
+        // OnStart is called for each component the frame they are loaded into the game
+        if (record.HasFunction(ON_START))
         {
-            // OnStart is called for each component the frame they are loaded into the game
-            luabridge::LuaRef OnStart = (*component.second)["OnStart"];
-            if (OnStart.isFunction())
-            {
-                OnStart(*component.second);
-            }
+            record.Call(ON_START, name);
         }
-        catch(const std::exception& e)
+        
+        // "OnStart" can add components, so the next one is only looked up once it has run.
+        // The processed component's node is kept so the next component initialized on this actor doesn't allocate one
+        auto next = std::next(component);
+        KeepSpareNode(componentsToAdd.extract(component));
+        component = next;
+    }
+}
+
+// Processes all components removed from the actor on this frame, returns true if any were removed
+bool Actor::ProcessRemovedComponents()
+{
+    // A destroyed actor loses all of its components, without them having to be listed by key
+    if (destroyed && !components.empty())
+    {
+        while (!components.empty())
         {
-            std::string errorMessage = e.what();
-#ifdef _WIN32
-            std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
-#endif
-            std::cout << "\033[31m" << name << " : " << errorMessage << "\033[0m" << std::endl;
+            RemoveInitializedComponent(components.begin());
         }
+        componentsToRemove.clear();
+        
+        return true;
     }
     
-    // Removes all the processed components from "componentsToAdd"
-    for (std::string key : processed)
+    if (componentsToRemove.empty()) {return false;}
+    
+    bool removedAny = false;
+    
+    for (auto& component_key : componentsToRemove)
     {
-        componentsToAdd.erase(key);
+        auto component = components.find(component_key);
+        if (component == components.end()) {continue;}
+        
+        RemoveInitializedComponent(component);
+        removedAny = true;
     }
+    componentsToRemove.clear();
+    
+    return removedAny;
 }
 
-// Calls "OnUpdate" for every component on this actor
-void Actor::Update()
+// Calls "OnDestroy" on an initialized component and takes it out of every list on this actor
+void Actor::RemoveInitializedComponent(std::map<std::string, std::shared_ptr<ComponentRecord>>::iterator component)
 {
-    // Don't both with updates if there are none
-    if (componentsToUpdate.empty()) {return;}
+    // Calls "OnDestroy" if this component contains that lifecycle function
+    if (component->second->HasFunction(ON_DESTROY))
+    {
+        component->second->Call(ON_DESTROY, name);
+    }
+    
+    // The scene drops it from its update lists
+    component->second->removed = true;
     
-    size_t size = componentsToUpdate.size();
-    for (int i = 0; i < size; i++)
+    // Coroutines it started are freed now, not the next time they would have been resumed
+    CoroutineScheduler::StopOwnedBy(component->second.get());
+    
+    for (auto& handlers : contactHandlers)
     {
-        // Don't update this Actor if it isn't enabled
-        if (enabled == false) {return;};
-        
-        std::string key = componentsToUpdate.front();
-        componentsToUpdate.pop();
-        
-        if (components.find(key) == components.end()) {continue;}
-        
-        std::shared_ptr<luabridge::LuaRef> component = components[key];
-        
-        // Push this component to the back of the queue
-        componentsToUpdate.push(key);
-        
-        // Don't update this component if it isn't enabled
-        if ((*component)["enabled"] == false) {continue;};
-        
-        // Don't update this component if it hasn't had a chance to run its "OnStart" function (if it exists)
-        if ((*component)["started"] == false) {continue;};
-        
-        try
-        {
-            // OnUpdate is called for each component every single frame
-            luabridge::LuaRef OnUpdate = (*component)["OnUpdate"];
-            if (OnUpdate.isFunction())
-            {
-                OnUpdate(*component);
-            }
-        }
-        catch(const std::exception& e)
-        {
-            std::string errorMessage = e.what();
-#ifdef _WIN32
-            std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
-#endif
-            std::cout << "\033[31m" << name << " : " << errorMessage << "\033[0m" << std::endl;
-        }
+        handlers.erase(std::remove(handlers.begin(), handlers.end(), component->second), handlers.end());
     }
     
-}
-
-// Calls "OnLateUpdate" for every component on this actor
-void Actor::LateUpdate()
-{
-    // Don't both with lateUpdates if there are none
-    if (componentsToUpdateLate.empty()) {return;}
+    ComponentTypeIndex& typeIndex = componentsByType[component->second->type];
+    typeIndex.components.erase(std::remove(typeIndex.components.begin(), typeIndex.components.end(), component->second), typeIndex.components.end());
+    typeIndex.cachedTable = nullptr;
     
-    size_t size = componentsToUpdateLate.size();
-    for (int i = 0; i < size; i++)
+    // A destroyed template actor keeps its components in case its template's pool takes it
+    if (destroyed && !templateName.empty())
     {
-        // Don't update this Actor if it isn't enabled
-        if (enabled == false) {return;};
-        
-        std::string key = componentsToUpdateLate.front();
-        componentsToUpdateLate.pop();
-        
-        if (components.find(key) == components.end()) {continue;}
-        
-        std::shared_ptr<luabridge::LuaRef> component = components[key];
-        
-        // Push this component to the back of the queue
-        componentsToUpdateLate.push(key);
-        
-        // Don't update this component if it isn't enabled
-        if ((*component)["enabled"] == false) {continue;};
-        
-        // Don't update this component if it hasn't had a chance to run its "OnStart" function (if it exists)
-        if ((*component)["started"] == false) {continue;};
-        
-        try
-        {
-            // OnLateUpdate is called after all OnUpdates for each component every single frame
-            luabridge::LuaRef OnLateUpdate = (*component)["OnLateUpdate"];
-            if (OnLateUpdate.isFunction())
-            {
-                OnLateUpdate(*component);
-            }
-        }
-        catch(const std::exception& e)
-        {
-            std::string errorMessage = e.what();
-#ifdef _WIN32
-            std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
-#endif
-            std::cout << "\033[31m" << name << " : " << errorMessage << "\033[0m" << std::endl;
-        }
+        recycledComponents.insert(components.extract(component));
+    }
+    else
+    {
+        KeepSpareNode(components.extract(component));
     }
 }
 
-// Processes all components removed from the actor on this frame
-void Actor::ProcessRemovedComponents()
+// Empties a node and keeps it for InitNewComponents
+void Actor::KeepSpareNode(std::map<std::string, std::shared_ptr<ComponentRecord>>::node_type node)
 {
-    for (auto& component_key : componentsToRemove)
-    {
-        // Calls "OnDestroy" if this component contains that lifecycle function
-        if (componentsWithOnDestroy.find(component_key) != componentsWithOnDestroy.end())
-        {
-            luabridge::LuaRef OnDestroy = (*components[component_key])["OnDestroy"];
-            OnDestroy(*components[component_key]);
-            componentsWithOnDestroy.erase(component_key);
-        }
-        
-        components.erase(component_key);
-    }
-    componentsToRemove.clear();
+    // The key's string keeps its buffer for the next key put in it
+    node.mapped() = nullptr;
+    spareComponentNodes.nodes.push_back(std::move(node));
 }
 
-// Calls OnCollisionEnter on every component on this actor that has it
-void Actor::CollisionEnter(Collision col)
+// Calls a contact function (OnCollisionEnter, OnCollisionExit, OnTriggerEnter or OnTriggerExit) on every component on this actor that has it
+void Actor::CallContactFunction(LifecycleFunction function, const Collision& col)
 {
-    // Don't both with calls if there are none
-    if (componentsWithCollisionEnter.empty()) {return;}
+    std::vector<std::shared_ptr<ComponentRecord>>& handlers = contactHandlers[function - ON_COLLISION_ENTER];
     
-    size_t size = componentsWithCollisionEnter.size();
-    for (int i = 0; i < size; i++)
+    for (size_t i = 0; i < handlers.size(); i++)
     {
-        // Don't update this Actor if it isn't enabled
+        // Don't call anything on this Actor if it isn't enabled
         if (enabled == false) {return;};
         
-        std::string key = componentsWithCollisionEnter.top();
-        componentsWithCollisionEnter.pop();
+        ComponentRecord& handler = *handlers[i];
         
-        if (components.find(key) == components.end()) {continue;}
+        // Don't call this component if it isn't enabled or hasn't had a chance to run its "OnStart" function (if it exists)
+        if (!handler.IsActive()) {continue;}
         
-        std::shared_ptr<luabridge::LuaRef> component = components[key];
-        
-        // Push this component to the back of the queue
-        componentsWithCollisionEnter.push(key);
-        
-        // Don't update this component if it isn't enabled
-        if ((*component)["enabled"] == false) {continue;};
-        
-        // Don't update this component if it hasn't had a chance to run its "OnStart" function (if it exists)
-        if ((*component)["started"] == false) {continue;};
-        
-        try
-        {
-            // OnUpdate is called for each component every single frame
-            luabridge::LuaRef OnCollisionEnter = (*component)["OnCollisionEnter"];
-            if (OnCollisionEnter.isFunction())
-            {
-                OnCollisionEnter(*component, col);
-            }
-        }
-        catch(const std::exception& e)
-        {
-            std::string errorMessage = e.what();
-#ifdef _WIN32
-            std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
-#endif
-            std::cout << "\033[31m" << name << " : " << errorMessage << "\033[0m" << std::endl;
-        }
+        handler.Call(function, col, name);
     }
 }
 
-// Calls OnCollisionEnter on every component on this actor that has it
-void Actor::CollisionExit(Collision col)
+// Calls "OnReset" on the components of an actor that was reused from its template's pool.
+// The components are the same tables and C++ objects the destroyed actor had, so a reference another script kept to one
+// now reaches this actor. Scripts that keep components of other actors should drop them when those actors are destroyed.
+void Actor::CallOnReset()
 {
-    // Don't both with calls if there are none
-    if (componentsWithCollisionExit.empty()) {return;}
-    
-    size_t size = componentsWithCollisionExit.size();
-    for (int i = 0; i < size; i++)
+    for (auto& component : components)
     {
-        // Don't update this Actor if it isn't enabled
-        if (enabled == false) {return;};
-        
-        std::string key = componentsWithCollisionExit.top();
-        componentsWithCollisionExit.pop();
-        
-        if (components.find(key) == components.end()) {continue;}
-        
-        std::shared_ptr<luabridge::LuaRef> component = components[key];
-        
-        // Push this component to the back of the queue
-        componentsWithCollisionExit.push(key);
-        
-        // Don't update this component if it isn't enabled
-        if ((*component)["enabled"] == false) {continue;};
-        
-        // Don't update this component if it hasn't had a chance to run its "OnStart" function (if it exists)
-        if ((*component)["started"] == false) {continue;};
-        
-        try
+        ComponentRecord& record = *component.second;
+        if (*record.enabled && record.HasFunction(ON_RESET))
         {
-            // OnUpdate is called for each component every single frame
-            luabridge::LuaRef OnCollisionExit = (*component)["OnCollisionExit"];
-            if (OnCollisionExit.isFunction())
-            {
-                OnCollisionExit(*component, col);
-            }
-        }
-        catch(const std::exception& e)
-        {
-            std::string errorMessage = e.what();
-#ifdef _WIN32
-            std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
-#endif
-            std::cout << "\033[31m" << name << " : " << errorMessage << "\033[0m" << std::endl;
+            record.Call(ON_RESET, name);
         }
     }
 }
 
-
-// Calls OnTriggerEnter on every component on this actor that has it
-void Actor::TriggerEnter(Collision col)
+// Puts a destroyed actor back the way its template made it so it can be instantiated again.
+// Returns false if it can't be, which happens when components were added or removed while it was alive.
+bool Actor::ResetToTemplate(const Actor& templateActor)
 {
-    // Don't both with calls if there are none
-    if (componentsWithTriggerEnter.empty()) { return; }
-
-    size_t size = componentsWithTriggerEnter.size();
-    for (int i = 0; i < size; i++)
+    if (!components.empty() || recycledComponents.size() != templateActor.componentsToAdd.size()) {return false;}
+    
+    for (auto& recycled : recycledComponents)
     {
-        // Don't update this Actor if it isn't enabled
-        if (enabled == false) { return; };
-
-        std::string key = componentsWithTriggerEnter.top();
-        componentsWithTriggerEnter.pop();
-
-        if (components.find(key) == components.end()) { continue; }
-
-        std::shared_ptr<luabridge::LuaRef> component = components[key];
-
-        // Push this component to the back of the queue
-        componentsWithTriggerEnter.push(key);
-
-        // Don't update this component if it isn't enabled
-        if ((*component)["enabled"] == false) { continue; };
-
-        // Don't update this component if it hasn't had a chance to run its "OnStart" function (if it exists)
-        if ((*component)["started"] == false) { continue; };
-
-        try
-        {
-            // OnUpdate is called for each component every single frame
-            luabridge::LuaRef OnTriggerEnter = (*component)["OnTriggerEnter"];
-            if (OnTriggerEnter.isFunction())
-            {
-                OnTriggerEnter(*component, col);
-            }
-        }
-        catch (const std::exception& e)
-        {
-            std::string errorMessage = e.what();
-#ifdef _WIN32
-            std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
-#endif
-            std::cout << "\033[31m" << name << " : " << errorMessage << "\033[0m" << std::endl;
-        }
+        auto source = templateActor.componentsToAdd.find(recycled.first);
+        if (source == templateActor.componentsToAdd.end() || source->second->type != recycled.second->type) {return false;}
+    }
+    
+    name = templateActor.name;
+    ID = -1;
+    enabled = templateActor.enabled;
+    destroyOnLoad = templateActor.destroyOnLoad;
+    destroyed = false;
+    tags = templateActor.tags;
+    
+    componentsToAdd.clear();
+    componentsToRemove.clear();
+    newComponents.clear();
+    
+    // The map nodes go straight back in, so nothing has to be allocated for them
+    while (!recycledComponents.empty())
+    {
+        auto recycled = recycledComponents.extract(recycledComponents.begin());
+        recycled.mapped()->Reset(*templateActor.componentsToAdd.at(recycled.key()));
+        componentsToAdd.insert(std::move(recycled));
     }
+    
+    return true;
 }
 
-// Calls OnTriggerExit on every component on this actor that has it
-void Actor::TriggerExit(Collision col)
+// Finds where the actor is from its Transform, or its Rigidbody if it doesn't have one.
+// Returns false if it has neither
+bool Actor::GetWorldPosition(b2Vec2& position)
 {
-    // Don't both with calls if there are none
-    if (componentsWithTriggerExit.empty()) { return; }
-
-    size_t size = componentsWithTriggerExit.size();
-    for (int i = 0; i < size; i++)
+    auto transforms = componentsByType.find("Transform");
+    if (transforms != componentsByType.end() && !transforms->second.components.empty())
     {
-        // Don't update this Actor if it isn't enabled
-        if (enabled == false) { return; };
-
-        std::string key = componentsWithTriggerExit.top();
-        componentsWithTriggerExit.pop();
-
-        if (components.find(key) == components.end()) { continue; }
-
-        std::shared_ptr<luabridge::LuaRef> component = components[key];
-
-        // Push this component to the back of the queue
-        componentsWithTriggerExit.push(key);
-
-        // Don't update this component if it isn't enabled
-        if ((*component)["enabled"] == false) { continue; };
-
-        // Don't update this component if it hasn't had a chance to run its "OnStart" function (if it exists)
-        if ((*component)["started"] == false) { continue; };
-
-        try
-        {
-            // OnUpdate is called for each component every single frame
-            luabridge::LuaRef OnTriggerExit = (*component)["OnTriggerExit"];
-            if (OnTriggerExit.isFunction())
-            {
-                OnTriggerExit(*component, col);
-            }
-        }
-        catch (const std::exception& e)
-        {
-            std::string errorMessage = e.what();
-#ifdef _WIN32
-            std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
-#endif
-            std::cout << "\033[31m" << name << " : " << errorMessage << "\033[0m" << std::endl;
-        }
+        position = transforms->second.components.front()->component->cast<Transform*>()->GetWorldPosition();
+        return true;
+    }
+    
+    auto rigidbodies = componentsByType.find("Rigidbody");
+    if (rigidbodies != componentsByType.end() && !rigidbodies->second.components.empty())
+    {
+        position = rigidbodies->second.components.front()->component->cast<Rigidbody*>()->GetPosition();
+        return true;
     }
+    
+    return false;
 }
 
 // Returns this actors name
@@ -387,6 +243,34 @@ int Actor::GetID()
     return ID;
 }
 
+// Tags this actor so Actor.FindWithTag can find it
+void Actor::AddTag(std::string tag)
+{
+    if (!tags.insert(tag).second) {return;}
+    
+    if (indexed)
+    {
+        SceneDB::currentScene.AddTagToIndex(this, tag);
+    }
+}
+
+// Removes a tag from this actor
+void Actor::RemoveTag(std::string tag)
+{
+    if (tags.erase(tag) == 0) {return;}
+    
+    if (indexed)
+    {
+        SceneDB::currentScene.RemoveTagFromIndex(this, tag);
+    }
+}
+
+// Returns true if this actor has the tag
+bool Actor::HasTag(std::string tag)
+{
+    return tags.find(tag) != tags.end();
+}
+
 // Adds a new component of the type name given to this actor and returns a reference to it
 luabridge::LuaRef Actor::AddComponent(std::string type_name)
 {
@@ -413,16 +297,24 @@ luabridge::LuaRef Actor::AddComponent(std::string type_name)
     // Gives the component its key
     newComponent["key"] = key;
     
+    std::shared_ptr<ComponentRecord> record = std::make_shared<ComponentRecord>(key, type_name, newComponent);
+    
     // Sets the component to be enabled by default
-    newComponent["enabled"] = true;
+    record->SetEnabled(true);
     
     // "Started" will be false unless the component has had a chance to try and run its "OnStart" function if one exists.
     // This is to prevent runtime-enabled components from running "OnUpdate" before "OnStart"
-    newComponent["started"] = false;
+    record->SetStarted(false);
     
-    componentsToAdd[key] = std::make_shared<luabridge::LuaRef>(newComponent);
+    componentsToAdd[key] = record;
     
-    InjectConvenienceReferences(componentsToAdd[key]);
+    InjectConvenienceReferences(*record);
+    
+    // Actors still being added to the scene initialize theirs when they are added
+    if (SceneDB::currentScene.actors.Contains(this))
+    {
+        SceneDB::currentScene.QueueNewComponents(this);
+    }
     
     return newComponent;
 }
@@ -432,6 +324,12 @@ void Actor::RemoveComponent(luabridge::LuaRef component_ref)
 {
     component_ref["enabled"] = false;
     componentsToRemove.push_back(component_ref["key"]);
+    
+    // A destroyed actor's components are all removed already
+    if (!destroyed)
+    {
+        SceneDB::currentScene.QueueRemovedComponents(this);
+    }
 }
 
 // Initializes new components created this frame
@@ -439,64 +337,59 @@ void Actor::InitNewComponents()
 {
     for (auto& component : componentsToAdd)
     {
-        std::string key = (*component.second)["key"].tostring();
+        std::shared_ptr<ComponentRecord> record = component.second;
         
         // Skip if this component has already been initialized
-        if (components.find(key) != components.end()) {continue;}
+        if (components.find(record->key) != components.end()) {continue;}
         
         // Injects the reference for all components before "OnStart" is called.
         // This allows Lua scripts to get the actor for another script during "OnStart".
-        InjectConvenienceReferences(component.second);
+        InjectConvenienceReferences(*record);
     
         // Add component to the components list
         // Doing this before the new component is processed allows new components to access each other before they are all processed.
-        components[key] = component.second;
-        
-        // If this component has an update function add it to the queue
-        luabridge::LuaRef OnUpdate = (*component.second)["OnUpdate"];
-        if (OnUpdate.isFunction())
+        // A spare node is used if there is one, so pooled actors don't allocate when they are instantiated again
+        if (!spareComponentNodes.nodes.empty())
         {
-            componentsToUpdate.push(key);
+            auto node = std::move(spareComponentNodes.nodes.back());
+            spareComponentNodes.nodes.pop_back();
+            node.key() = record->key;
+            node.mapped() = record;
+            components.insert(std::move(node));
         }
-        // If this component has a late update function add it to the queue
-        luabridge::LuaRef OnLateUpdate = (*component.second)["OnLateUpdate"];
-        if (OnLateUpdate.isFunction())
+        else
         {
-            componentsToUpdateLate.push(key);
+            components.emplace(record->key, record);
         }
         
-        // If this component has a OnCollisionEnter function add it to the queue
-        luabridge::LuaRef OnCollisionEnter = (*component.second)["OnCollisionEnter"];
-        if (OnCollisionEnter.isFunction())
-        {
-            componentsWithCollisionEnter.push(key);
-        }
-        // If this component has a OnCollisionExit function add it to the queue
-        luabridge::LuaRef OnCollisionExit = (*component.second)["OnCollisionExit"];
-        if (OnCollisionExit.isFunction())
-        {
-            componentsWithCollisionExit.push(key);
-        }
-
-        // If this component has a OnTriggerEnter function add it to the queue
-        luabridge::LuaRef OnTriggerEnter = (*component.second)["OnTriggerEnter"];
-        if (OnTriggerEnter.isFunction())
-        {
-            componentsWithTriggerEnter.push(key);
-        }
-
-        // If this component has a OnTriggerExit function add it to the queue
-        luabridge::LuaRef OnTriggerExit = (*component.second)["OnTriggerExit"];
-        if (OnTriggerExit.isFunction())
+        // Looks up the lifecycle functions once so calling them later doesn't have to
+        record->ResolveFunctions();
+        
+        // The scene adds it to its update lists, in the order components were initialized
+        record->initOrder = ActorDB::numInitializedComponents;
+        ActorDB::numInitializedComponents++;
+        if (record->native != nullptr)
         {
-            componentsWithTriggerExit.push(key);
+            record->native->getBase(*record->component)->initOrder = record->initOrder;
         }
+        newComponents.push_back(record);
         
-        // If this component has an OnDestroy function add it to the set
-        luabridge::LuaRef OnDestroy = (*component.second)["OnDestroy"];
-        if (OnDestroy.isFunction())
+        // Lets GetComponent find it by type, in key order
+        ComponentTypeIndex& typeIndex = componentsByType[record->type];
+        typeIndex.components.insert(std::upper_bound(typeIndex.components.begin(), typeIndex.components.end(), record,
+            [](const std::shared_ptr<ComponentRecord>& a, const std::shared_ptr<ComponentRecord>& b) {return a->key < b->key;}), record);
+        typeIndex.cachedTable = nullptr;
+        
+        // If this component has any contact functions add it to their lists, in key order
+        for (int function = ON_COLLISION_ENTER; function <= ON_TRIGGER_EXIT; function++)
         {
-            componentsWithOnDestroy.insert(key);
+            if (record->HasFunction(static_cast<LifecycleFunction>(function)))
+            {
+                std::vector<std::shared_ptr<ComponentRecord>>& handlers = contactHandlers[function - ON_COLLISION_ENTER];
+                auto position = std::upper_bound(handlers.begin(), handlers.end(), record,
+                    [](const std::shared_ptr<ComponentRecord>& a, const std::shared_ptr<ComponentRecord>& b) {return a->key < b->key;});
+                handlers.insert(position, record);
+            }
         }
     }
 }
@@ -507,11 +400,12 @@ luabridge::LuaRef Actor::GetComponentByKey(std::string key)
     // Return null if there are no components on this actor
     if (components.empty()) {return luabridge::LuaRef(ComponentDB::luaState);}
     
-    if (components.find(key) != components.end())
+    auto component = components.find(key);
+    if (component != components.end())
     {
-        if ((*components[key])["enabled"] == true)
+        if (*component->second->enabled == true)
         {
-            return *components[key];
+            return *component->second->component;
         }
     }
     
@@ -522,14 +416,14 @@ luabridge::LuaRef Actor::GetComponentByKey(std::string key)
 // If multiple components have this type this returns the first one (sorted by its key)
 luabridge::LuaRef Actor::GetComponent(std::string type_name)
 {
-    // Return null if there are no components on this actor
-    if (components.empty()) {return luabridge::LuaRef(ComponentDB::luaState);}
+    auto typeIndex = componentsByType.find(type_name);
+    if (typeIndex == componentsByType.end()) {return luabridge::LuaRef(ComponentDB::luaState);}
     
-    for (auto& component : components)
+    for (auto& component : typeIndex->second.components)
     {
-        if ((*component.second)["type"].tostring() == type_name && (*component.second)["enabled"] == true)
+        if (*component->enabled == true)
         {
-            return *component.second;
+            return *component->component;
         }
     }
     
@@ -537,34 +431,98 @@ luabridge::LuaRef Actor::GetComponent(std::string type_name)
 }
 
 // Returns all of the components on this actor that are of the given type
+// The table is reused between calls while the components don't change, so Lua shouldn't modify it
 luabridge::LuaRef Actor::GetComponents(std::string type_name)
 {
     // Return null if there are no components on this actor
     if (components.empty()) {return luabridge::LuaRef(ComponentDB::luaState);}
     
+    ComponentTypeIndex& typeIndex = componentsByType[type_name];
+    
+    // The cached table is still right if the same components are enabled as when it was made
+    if (typeIndex.cachedTable != nullptr)
+    {
+        size_t numEnabled = 0;
+        bool unchanged = true;
+        for (auto& component : typeIndex.components)
+        {
+            if (*component->enabled == false) {continue;}
+            
+            if (numEnabled >= typeIndex.cachedComponents.size() || typeIndex.cachedComponents[numEnabled] != component.get())
+            {
+                unchanged = false;
+                break;
+            }
+            numEnabled++;
+        }
+        
+        if (unchanged && numEnabled == typeIndex.cachedComponents.size())
+        {
+            return *typeIndex.cachedTable;
+        }
+    }
+    
     // Creates and gets a reference to a new table on the Lua stack
-    lua_newtable(ComponentDB::luaState);
+    lua_createtable(ComponentDB::luaState, static_cast<int>(typeIndex.components.size()), 0);
     luabridge::LuaRef componentsOfType(luabridge::get<luabridge::LuaRef>(ComponentDB::luaState, -1));
+    lua_pop(ComponentDB::luaState, 1);
     
-    componentsOfType[0] = luabridge::LuaRef(ComponentDB::luaState);
+    typeIndex.cachedComponents.clear();
     int i = 1;
     
-    for (auto& component : components)
+    for (auto& component : typeIndex.components)
     {
-        if ((*component.second)["type"] == type_name && (*component.second)["enabled"] == true)
+        if (*component->enabled == true)
         {
-            componentsOfType[i] = *component.second;
+            componentsOfType[i] = *component->component;
+            typeIndex.cachedComponents.push_back(component.get());
             i++;
         }
     }
     
+    typeIndex.cachedTable = std::make_shared<luabridge::LuaRef>(componentsOfType);
     return componentsOfType;
 }
 
 // Injects a reference to this actor into the components so that developers can get the actor that a component is on.
-void Actor::InjectConvenienceReferences(std::shared_ptr<luabridge::LuaRef> component_ref)
+// Lua components get the actor's handle, C++ components keep the actor too so they don't have to look it up.
+void Actor::InjectConvenienceReferences(ComponentRecord& record)
+{
+    if (record.native != nullptr)
+    {
+        NativeComponent* component = record.native->getBase(*record.component);
+        component->actor = this;
+        component->actorHandle = handle;
+        return;
+    }
+    
+    (*record.component)["actor"] = ActorRef(handle);
+}
+
+// Makes this actor a new copy of a compiled template
+void Actor::Clone(const ActorBlueprint& blueprint)
 {
-    (*component_ref)["actor"] = this;
+    const Actor& templateActor = blueprint.templateActor;
+    name = templateActor.name;
+    enabled = templateActor.enabled;
+    destroyOnLoad = templateActor.destroyOnLoad;
+    tags = templateActor.tags;
+    templateName = blueprint.templateName;
+    
+    for (const ComponentBlueprint& component : blueprint.components)
+    {
+        ComponentRecord& source = *component.source;
+        
+        luabridge::LuaRef newComponent = component.isCPP ? ComponentDB::CopyCPPComponent(source.component, source.type) : ComponentDB::NewInstance(*source.component);
+        
+        // Copies start with the same flags and lifecycle functions as the template's component
+        std::shared_ptr<ComponentRecord> record = std::make_shared<ComponentRecord>(source, newComponent);
+        record->SetEnabled(*source.enabled);
+        record->SetStarted(false);
+        
+        // The blueprint is already in key order
+        componentsToAdd.emplace_hint(componentsToAdd.end(), source.key, std::move(record));
+    }
 }
 
 // Initializes an actor with the values in JSON code
@@ -576,6 +534,14 @@ void Actor::LoadActorWithJSON(const rapidjson::Value& actorData)
         name = actorData["name"].GetString();
     }
     
+    if (actorData.HasMember("tags"))
+    {
+        for (auto& tag : actorData["tags"].GetArray())
+        {
+            tags.insert(tag.GetString());
+        }
+    }
+    
     // Components
     if (actorData.HasMember("components"))
     {
@@ -589,11 +555,12 @@ void Actor::LoadActorWithJSON(const rapidjson::Value& actorData)
             
             // Access the key of the component
             std::string key = itr->name.GetString();
+            std::string type;
             
             // Establishes inheritance between the new component and its type if specified
             if (itr->value.HasMember("type"))
             {
-                std::string type = itr->value["type"].GetString();
+                type = itr->value["type"].GetString();
                 
                 // Different creation methods if this component is C++ or Lua based
                 if (ComponentDB::IsComponentTypeCPP(type))
@@ -610,14 +577,16 @@ void Actor::LoadActorWithJSON(const rapidjson::Value& actorData)
             // If the type is not specified for this component, check if its already been set
             else if (componentsToAdd.find(key) != componentsToAdd.end())
             {
+                type = componentsToAdd[key]->type;
+                
                 // Makes our new component a copy of the templated one
-                if (ComponentDB::IsComponentTypeCPP((*componentsToAdd[key])["type"]))
+                if (ComponentDB::IsComponentTypeCPP(type))
                 {
-                    newComponent = ComponentDB::CopyCPPComponent(componentsToAdd[key], (*componentsToAdd[key])["type"]);
+                    newComponent = ComponentDB::CopyCPPComponent(componentsToAdd[key]->component, type);
                 }
                 else
                 {
-                    ComponentDB::EstablishInheritance(newComponent, *componentsToAdd[key]);
+                    ComponentDB::EstablishInheritance(newComponent, *componentsToAdd[key]->component);
                 }
             }
             // If the type for this component is not specified anywhere, throw an error
@@ -630,13 +599,22 @@ void Actor::LoadActorWithJSON(const rapidjson::Value& actorData)
             // Gives the component its key
             newComponent["key"] = key;
             
+            std::shared_ptr<ComponentRecord> record = std::make_shared<ComponentRecord>(key, type, newComponent);
+            
             // Sets the component to be enabled by default
-            newComponent["enabled"] = true;
+            record->SetEnabled(true);
             
             // "Started" will be false unless the component has had a chance to try and run its "OnStart" function if one exists.
             // This is to prevent runtime-enabled components from running "OnUpdate" before "OnStart"
-            newComponent["started"] = false;
+            record->SetStarted(false);
             
+            // C++ components set the fields their type declared straight from the JSON
+            if (record->native != nullptr)
+            {
+                record->native->LoadProperties(newComponent, itr->value);
+                componentsToAdd[key] = record;
+                continue;
+            }
             
             // Preform required overrides on component properties
             // Sets component properties to specified values
@@ -707,7 +685,7 @@ void Actor::LoadActorWithJSON(const rapidjson::Value& actorData)
                 }
             }
             
-            componentsToAdd[key] = std::make_shared<luabridge::LuaRef>(newComponent);
+            componentsToAdd[key] = record;
         }
     }
 }
@@ -719,6 +697,7 @@ Actor& Actor::operator=(const Actor &copiedActor)
     enabled = copiedActor.enabled;
     destroyOnLoad = copiedActor.destroyOnLoad;
     destroyed = copiedActor.destroyed;
+    tags = copiedActor.tags;
     
     // Copies over their components
     for (auto component : copiedActor.componentsToAdd)
@@ -727,16 +706,23 @@ Actor& Actor::operator=(const Actor &copiedActor)
         lua_newtable(ComponentDB::luaState);
         luabridge::LuaRef newComponent(luabridge::get<luabridge::LuaRef>(ComponentDB::luaState, -1));
         
-        if (ComponentDB::IsComponentTypeCPP((*component.second)["type"]))
+        const ComponentRecord& copiedRecord = *component.second;
+        
+        if (ComponentDB::IsComponentTypeCPP(copiedRecord.type))
         {
-            newComponent = ComponentDB::CopyCPPComponent(component.second, (*component.second)["type"]);
+            newComponent = ComponentDB::CopyCPPComponent(copiedRecord.component, copiedRecord.type);
         }
         else
         {
-            ComponentDB::EstablishInheritance(newComponent, *component.second);
+            ComponentDB::EstablishInheritance(newComponent, *copiedRecord.component);
         }
         
-        componentsToAdd[newComponent["key"]] = std::make_shared<luabridge::LuaRef>(newComponent);
+        // Copies start with the same flags as the component they were copied from
+        std::shared_ptr<ComponentRecord> record = std::make_shared<ComponentRecord>(copiedRecord.key, copiedRecord.type, newComponent);
+        record->SetEnabled(*copiedRecord.enabled);
+        record->SetStarted(*copiedRecord.started);
+        
+        componentsToAdd[record->key] = record;
     }
     
     return *this;
@@ -0,0 +1,46 @@
+//
+//  ActorPool.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/16/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+
+#include "ActorPool.h"
+#include "Actor.h"
+#include "TemplateDB.h"
+
+// Returns an actor that was made from the template and has been reset, or nullptr if there isn't one
+std::shared_ptr<Actor> ActorPool::Take(const std::string& templateName)
+{
+    auto pool = pools.find(templateName);
+    if (pool == pools.end() || pool->second.empty()) {return nullptr;}
+    
+    std::shared_ptr<Actor> actor = std::move(pool->second.back());
+    pool->second.pop_back();
+    return actor;
+}
+
+// Resets a destroyed actor and keeps it for the next time its template is instantiated.
+// It is freed instead if anything else still owns it or it no longer matches its template.
+void ActorPool::Return(std::shared_ptr<Actor> actor)
+{
+    if (!enabled || actor->templateName.empty() || actor.use_count() != 1) {return;}
+    
+    std::vector<std::shared_ptr<Actor>>& pool = pools[actor->templateName];
+    if (pool.size() >= MAX_POOLED_ACTORS) {return;}
+    
+    const Actor* templateActor = TemplateDB::FindTemplate(actor->templateName);
+    if (templateActor == nullptr || !actor->ResetToTemplate(*templateActor)) {return;}
+    
+    pool.push_back(std::move(actor));
+}
+
+// Frees every pooled actor
+void ActorPool::Clear()
+{
+    pools.clear();
+}
@@ -0,0 +1,91 @@
+//
+//  ActorRef.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/23/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+
+#include "ActorRef.h"
+#include "Actor.h"
+#include "SceneDB.h"
+
+// Refers to the actor, or to nothing (nil in Lua) for nullptr
+ActorRef::ActorRef(const Actor* actor)
+{
+    if (actor != nullptr) {handle = actor->handle;}
+}
+
+// Returns the actor this refers to, or nullptr if it isn't in the current scene anymore
+Actor* ActorRef::Get() const
+{
+    return SceneDB::currentScene.actors.Get(handle);
+}
+
+// The actor's functions in Lua
+std::string ActorRef::GetName() const
+{
+    Actor* actor = Get();
+    return actor != nullptr ? actor->GetName() : "";
+}
+
+int ActorRef::GetID() const
+{
+    Actor* actor = Get();
+    return actor != nullptr ? actor->GetID() : -1;
+}
+
+luabridge::LuaRef ActorRef::GetComponentByKey(std::string key) const
+{
+    Actor* actor = Get();
+    if (actor == nullptr) {return luabridge::LuaRef(ComponentDB::luaState);}
+    return actor->GetComponentByKey(key);
+}
+
+luabridge::LuaRef ActorRef::GetComponent(std::string type_name) const
+{
+    Actor* actor = Get();
+    if (actor == nullptr) {return luabridge::LuaRef(ComponentDB::luaState);}
+    return actor->GetComponent(type_name);
+}
+
+luabridge::LuaRef ActorRef::GetComponents(std::string type_name) const
+{
+    Actor* actor = Get();
+    if (actor == nullptr) {return luabridge::LuaRef(ComponentDB::luaState);}
+    return actor->GetComponents(type_name);
+}
+
+luabridge::LuaRef ActorRef::AddComponent(std::string type_name) const
+{
+    Actor* actor = Get();
+    if (actor == nullptr) {return luabridge::LuaRef(ComponentDB::luaState);}
+    return actor->AddComponent(type_name);
+}
+
+void ActorRef::RemoveComponent(luabridge::LuaRef component_ref) const
+{
+    Actor* actor = Get();
+    if (actor != nullptr) {actor->RemoveComponent(component_ref);}
+}
+
+void ActorRef::AddTag(std::string tag) const
+{
+    Actor* actor = Get();
+    if (actor != nullptr) {actor->AddTag(tag);}
+}
+
+void ActorRef::RemoveTag(std::string tag) const
+{
+    Actor* actor = Get();
+    if (actor != nullptr) {actor->RemoveTag(tag);}
+}
+
+bool ActorRef::HasTag(std::string tag) const
+{
+    Actor* actor = Get();
+    return actor != nullptr && actor->HasTag(tag);
+}
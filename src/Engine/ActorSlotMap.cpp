@@ -0,0 +1,221 @@
+//
+//  ActorSlotMap.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/15/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <algorithm>
+#include <iostream>
+
+#include "ActorSlotMap.h"
+#include "Actor.h"
+
+// Orders actors by ID for the dense array
+static bool ActorIDLess(const Actor* a, const Actor* b)
+{
+    return a->ID < b->ID;
+}
+
+// Adds an actor and gives it its handle, an actor that already claimed one keeps it
+ActorHandle ActorSlotMap::Insert(std::shared_ptr<Actor> actor)
+{
+    const Slot* claimed = GetSlot(actor->handle);
+    if (claimed == nullptr || claimed->actor != actor)
+    {
+        Claim(actor);
+    }
+
+    Slot& slot = slots[actor->handle & INDEX_MASK];
+    if (slot.inserted) {return actor->handle;}
+    slot.inserted = true;
+
+    // Actors are almost always added in ID order, so this is nearly always a push_back
+    if (dense.empty() || dense.back()->ID < actor->ID)
+    {
+        dense.push_back(actor.get());
+    }
+    else
+    {
+        dense.insert(std::upper_bound(dense.begin(), dense.end(), actor.get(), ActorIDLess), actor.get());
+    }
+
+    return actor->handle;
+}
+
+// Gives an actor a handle without adding it to the actors that are iterated over, Insert adds it once it is in the scene
+ActorHandle ActorSlotMap::Claim(std::shared_ptr<Actor> actor)
+{
+    uint32_t index;
+    if (!freeSlots.empty())
+    {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        // The last index is left out so no handle can equal INVALID_HANDLE
+        if (slots.size() >= INDEX_MASK)
+        {
+            std::cout << "error: too many actors in the scene";
+            exit(0);
+        }
+
+        index = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+
+    Slot& slot = slots[index];
+    slot.actor = actor;
+    slot.inserted = false;
+
+    ActorHandle handle = (slot.generation << INDEX_BITS) | index;
+    actor->handle = handle;
+    return handle;
+}
+
+// Removes the actor with the given handle, does nothing if the handle is stale
+void ActorSlotMap::Remove(ActorHandle handle)
+{
+    if (GetSlot(handle) == nullptr) {return;}
+
+    uint32_t index = handle & INDEX_MASK;
+    Slot& slot = slots[index];
+
+    // Keeps the dense array in ID order
+    auto position = std::lower_bound(dense.begin(), dense.end(), slot.actor.get(), ActorIDLess);
+    while (position != dense.end() && *position != slot.actor.get())
+    {
+        position++;
+    }
+    if (position != dense.end())
+    {
+        dense.erase(position);
+    }
+
+    slot.actor->handle = INVALID_HANDLE;
+    FreeSlot(index);
+}
+
+// Removes the actors with the given handles, the rest of the actors are only shifted down once
+void ActorSlotMap::Remove(const std::vector<ActorHandle>& handles)
+{
+    if (handles.empty()) {return;}
+    
+    // Marks the actors first, the slots keep them alive until they are out of the dense array
+    bool removedAny = false;
+    for (ActorHandle handle : handles)
+    {
+        const Slot* slot = GetSlot(handle);
+        if (slot == nullptr) {continue;}
+        
+        slot->actor->handle = INVALID_HANDLE;
+        removedAny = true;
+    }
+    if (!removedAny) {return;}
+    
+    dense.erase(std::remove_if(dense.begin(), dense.end(), [](const Actor* actor) {return actor->handle == INVALID_HANDLE;}), dense.end());
+    
+    for (ActorHandle handle : handles)
+    {
+        uint32_t index = handle & INDEX_MASK;
+        if (index >= slots.size()) {continue;}
+        
+        // Only slots marked above still hold an actor with an invalid handle
+        Slot& slot = slots[index];
+        if (slot.actor == nullptr || slot.actor->handle != INVALID_HANDLE || slot.generation != (handle >> INDEX_BITS)) {continue;}
+        
+        FreeSlot(index);
+    }
+}
+
+// Returns the actor with the given handle (inserted or only claimed), or nullptr if it has been removed
+Actor* ActorSlotMap::Get(ActorHandle handle) const
+{
+    const Slot* slot = GetSlot(handle);
+    return slot != nullptr ? slot->actor.get() : nullptr;
+}
+
+std::shared_ptr<Actor> ActorSlotMap::GetShared(ActorHandle handle) const
+{
+    const Slot* slot = GetSlot(handle);
+    return slot != nullptr ? slot->actor : nullptr;
+}
+
+// Returns true if the actor has been inserted into this map
+bool ActorSlotMap::Contains(const Actor* actor) const
+{
+    if (actor == nullptr) {return false;}
+
+    const Slot* slot = GetSlot(actor->handle);
+    return slot != nullptr && slot->actor.get() == actor && slot->inserted;
+}
+
+// Returns the actor with the given ID, or nullptr if there isn't one
+Actor* ActorSlotMap::FindByID(int ID) const
+{
+    auto position = std::lower_bound(dense.begin(), dense.end(), ID, [](const Actor* actor, int ID) {return actor->ID < ID;});
+    if (position != dense.end() && (*position)->ID == ID)
+    {
+        return *position;
+    }
+    return nullptr;
+}
+
+// Removes every actor, their handles stay stale after the slots are reused
+void ActorSlotMap::Clear()
+{
+    for (uint32_t index = 0; index < slots.size(); index++)
+    {
+        if (slots[index].actor == nullptr) {continue;}
+
+        slots[index].actor->handle = INVALID_HANDLE;
+        FreeSlot(index);
+    }
+
+    dense.clear();
+}
+
+// Makes room for count actors so adding them doesn't reallocate
+void ActorSlotMap::Reserve(size_t count)
+{
+    // Grows by at least double so reserving a little more every frame doesn't reallocate every frame
+    if (dense.capacity() < count)
+    {
+        dense.reserve(std::max(count, dense.capacity() * 2));
+    }
+    
+    // Free slots are used before new ones are made, so only the rest need room
+    size_t slotsNeeded = std::max(slots.size(), count);
+    if (slots.capacity() < slotsNeeded)
+    {
+        slots.reserve(std::max(slotsNeeded, slots.capacity() * 2));
+    }
+}
+
+// Returns the slot a handle points to if it is still valid
+const ActorSlotMap::Slot* ActorSlotMap::GetSlot(ActorHandle handle) const
+{
+    if (handle == INVALID_HANDLE) {return nullptr;}
+
+    uint32_t index = handle & INDEX_MASK;
+    if (index >= slots.size()) {return nullptr;}
+
+    const Slot& slot = slots[index];
+    if (slot.actor == nullptr || slot.generation != (handle >> INDEX_BITS)) {return nullptr;}
+
+    return &slot;
+}
+
+// Empties a slot and moves it on to its next generation
+void ActorSlotMap::FreeSlot(uint32_t index)
+{
+    Slot& slot = slots[index];
+    slot.actor.reset();
+    slot.inserted = false;
+    slot.generation = (slot.generation + 1) & GENERATION_MASK;
+    freeSlots.push_back(index);
+}
@@ -24,13 +24,23 @@ void AudioDB::LoadAudio()
         {
             if (audioFile.path() != audioDirectoryPath + "/.DS_Store")
             {
+                // Headless runs have no audio device, clips are only registered so they can still be played by name
+                if (EngineUtils::headless)
+                {
+                    loadedAudio[audioFile.path().filename().stem().stem().string()] = nullptr;
+                    continue;
+                }
+                
                 AudioHelper::Mix_OpenAudio498(48000, AUDIO_S16SYS, 1, 1024);
                 Mix_Chunk* sound = AudioHelper::Mix_LoadWAV498(audioFile.path().string().c_str());
                 loadedAudio[audioFile.path().filename().stem().stem().string()] = sound;
             }
         }
     }
-    AudioHelper::Mix_AllocateChannels498(50);
+    if (!EngineUtils::headless)
+    {
+        AudioHelper::Mix_AllocateChannels498(50);
+    }
 }
 
 // Play audio from loadedAudio based its name
@@ -46,17 +56,23 @@ void AudioDB::PlayAudio(int channel, std::string audioName, bool loop)
     int numLoops = 0;
     if (loop) {numLoops = -1;}
     
+    if (EngineUtils::headless) {return;}
+    
     AudioHelper::Mix_PlayChannel498(channel, loadedAudio[audioName], numLoops);
 }
 
 // Halt the audio on the given channel
 void AudioDB::HaltAudio(int channel)
 {
+    if (EngineUtils::headless) {return;}
+    
     AudioHelper::Mix_HaltChannel498(channel);
 }
 
 // Changes the volume of a specific audio channel
 void AudioDB::SetVolume(int channel, int volume)
 {
+    if (EngineUtils::headless) {return;}
+    
     AudioHelper::Mix_Volume498(channel, volume);
 }
@@ -0,0 +1,286 @@
+//
+//  Benchmark.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/13/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+
+#include "Benchmark.h"
+#include "Helper.h"
+#include "Application.h"
+#include "SceneDB.h"
+#include "ComponentDB.h"
+#include "PhysicsHandler.h"
+#include "TimeHandler.h"
+#include "LuaGC.h"
+#include "LuaAllocator.h"
+
+bool Benchmark::active = false;
+unsigned int Benchmark::seed = 0;
+bool Benchmark::seedSet = false;
+std::string Benchmark::replayPath;
+std::string Benchmark::outputPath;
+
+std::atomic<long long> Benchmark::allocations{0};
+std::atomic<long long> Benchmark::bytesAllocated{0};
+
+std::vector<double> Benchmark::frameTimes;
+Uint64 Benchmark::lastFrameEnd = 0;
+long long Benchmark::startAllocations = 0;
+long long Benchmark::startBytesAllocated = 0;
+
+#ifdef GAME_ENGINE_COUNT_ALLOCATIONS
+// Counts every C++ heap allocation so benchmarks can report them (Lua's allocations go through its own allocator).
+// Only the game_engine_benchmark target replaces operator new, every other build keeps the standard one
+void* operator new(std::size_t size)
+{
+    Benchmark::allocations.fetch_add(1, std::memory_order_relaxed);
+    Benchmark::bytesAllocated.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) {throw std::bad_alloc();}
+    return memory;
+}
+
+void* operator new[](std::size_t size) {return operator new(size);}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {return operator new(size);}
+    catch (...) {return nullptr;}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try {return operator new(size);}
+    catch (...) {return nullptr;}
+}
+
+void operator delete(void* memory) noexcept {std::free(memory);}
+void operator delete[](void* memory) noexcept {std::free(memory);}
+void operator delete(void* memory, std::size_t) noexcept {std::free(memory);}
+void operator delete[](void* memory, std::size_t) noexcept {std::free(memory);}
+void operator delete(void* memory, const std::nothrow_t&) noexcept {std::free(memory);}
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {std::free(memory);}
+#endif
+
+// Adds some bytes to an FNV-1a hash
+static void HashBytes(uint64_t& hash, const void* data, size_t length)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+template <typename T>
+static void HashValue(uint64_t& hash, const T& value)
+{
+    HashBytes(hash, &value, sizeof(T));
+}
+
+// Points the input playback at the replay file, has to be set before the first event is polled
+void Benchmark::SetReplay(const std::string& path)
+{
+    // Stored absolute so --game can change the working directory afterwards
+    replayPath = std::filesystem::absolute(path).string();
+    Helper::USER_INPUT_FILENAME = replayPath.c_str();
+}
+
+// Seeds the random number generators and starts measuring, called once everything is loaded
+void Benchmark::Init()
+{
+    if (seedSet || active)
+    {
+        Application::SeedRandom(seed);
+
+        // Lua seeds math.random from the clock when the state is made
+        lua_State* luaState = ComponentDB::luaState;
+        lua_getglobal(luaState, "math");
+        lua_getfield(luaState, -1, "randomseed");
+        lua_pushinteger(luaState, static_cast<lua_Integer>(seed));
+        lua_pcall(luaState, 1, 0, 0);
+        lua_pop(luaState, 1);
+    }
+
+    if (!active) {return;}
+
+    frameTimes.clear();
+    lastFrameEnd = SDL_GetPerformanceCounter();
+    startAllocations = allocations.load();
+    startBytesAllocated = bytesAllocated.load();
+
+    std::atexit(Report);
+}
+
+// The number of frames the replay file has input for, 0 if there's no replay
+int Benchmark::GetReplayLength()
+{
+    if (replayPath.empty()) {return 0;}
+
+    std::ifstream replayFile(replayPath);
+    if (!replayFile.is_open())
+    {
+        std::cout << "error: missing replay file " << replayPath;
+        exit(0);
+    }
+
+    // Every line starts with the frame its events happen on
+    int lastFrame = -1;
+    std::string line;
+    while (std::getline(replayFile, line))
+    {
+        if (line.empty()) {continue;}
+        lastFrame = std::max(lastFrame, std::atoi(line.c_str()));
+    }
+    return lastFrame + 1;
+}
+
+// Records how long the frame that just finished took
+void Benchmark::EndFrame()
+{
+    if (!active) {return;}
+
+    Uint64 frameEnd = SDL_GetPerformanceCounter();
+    frameTimes.push_back(static_cast<double>(frameEnd - lastFrameEnd) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency()));
+    lastFrameEnd = frameEnd;
+}
+
+// Hashes everything that should come out the same on every run of the same replay (FNV-1a)
+uint64_t Benchmark::ComputeChecksum()
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    HashValue(hash, Helper::frame_number);
+    HashValue(hash, TimeHandler::time);
+    HashBytes(hash, SceneDB::currentScene.name.data(), SceneDB::currentScene.name.size());
+
+    // Which actors exist, in ID order
+    for (Actor* actor : SceneDB::currentScene.actors)
+    {
+        HashValue(hash, actor->ID);
+        HashBytes(hash, actor->name.data(), actor->name.size());
+    }
+
+    // Where every physics body ended up
+    if (PhysicsHandler::phyicsActive)
+    {
+        for (b2Body* body = PhysicsHandler::world->GetBodyList(); body != nullptr; body = body->GetNext())
+        {
+            HashValue(hash, body->GetPosition().x);
+            HashValue(hash, body->GetPosition().y);
+            HashValue(hash, body->GetAngle());
+            HashValue(hash, body->GetLinearVelocity().x);
+            HashValue(hash, body->GetLinearVelocity().y);
+        }
+    }
+
+    const Camera& camera = SceneDB::currentScene.camera;
+    HashValue(hash, camera.position.x);
+    HashValue(hash, camera.position.y);
+    HashValue(hash, camera.zoom);
+
+    return hash;
+}
+
+// Gets the frame time at the given percentile (0 - 100)
+double Benchmark::GetPercentile(std::vector<double>& sortedTimes, double percentile)
+{
+    if (sortedTimes.empty()) {return 0.0;}
+
+    size_t index = static_cast<size_t>((percentile / 100.0) * (sortedTimes.size() - 1) + 0.5);
+    return sortedTimes[std::min(index, sortedTimes.size() - 1)];
+}
+
+// Prints the results (and writes them to outputPath), registered with atexit so games that quit themselves still report
+void Benchmark::Report()
+{
+    std::vector<double> sortedTimes = frameTimes;
+    std::sort(sortedTimes.begin(), sortedTimes.end());
+
+    double p50 = GetPercentile(sortedTimes, 50.0);
+    double p95 = GetPercentile(sortedTimes, 95.0);
+    double p99 = GetPercentile(sortedTimes, 99.0);
+    double maximum = sortedTimes.empty() ? 0.0 : sortedTimes.back();
+
+    long long frameAllocations = allocations.load() - startAllocations;
+    long long frameBytes = bytesAllocated.load() - startBytesAllocated;
+    int frames = static_cast<int>(frameTimes.size());
+    double allocationsPerFrame = frames > 0 ? static_cast<double>(frameAllocations) / frames : 0.0;
+
+    double gcAverage = frames > 0 ? LuaGC::GetTotalCollectionTime() / frames : 0.0;
+    double heapKilobytes = static_cast<double>(LuaGC::GetHeapBytes()) / 1024.0;
+    double peakHeapKilobytes = static_cast<double>(LuaGC::GetPeakHeapBytes()) / 1024.0;
+
+    std::stringstream checksum;
+    checksum << std::hex << std::setw(16) << std::setfill('0') << ComputeChecksum();
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "benchmark: " << frames << " frames, seed " << seed << std::endl
+              << "frame time (ms): p50 " << p50 << " p95 " << p95 << " p99 " << p99 << " max " << maximum << std::endl
+              << "allocations: ";
+    if (countsAllocations)
+    {
+        std::cout << frameAllocations << " (" << frameBytes << " bytes, " << allocationsPerFrame << " per frame)" << std::endl;
+    }
+    else
+    {
+        std::cout << "not counted, build game_engine_benchmark to count them" << std::endl;
+    }
+    std::cout
+              << "lua gc (ms): average " << gcAverage << " max " << LuaGC::GetMaxCollectionTime() << ", " << LuaGC::GetCompletedCycles() << " cycles" << std::endl
+              << "lua heap (KB): " << heapKilobytes << " peak " << peakHeapKilobytes << std::endl
+              << "lua allocator (KB): " << static_cast<double>(LuaAllocator::GetBytesInUse()) / 1024.0 << " in use, "
+              << static_cast<double>(LuaAllocator::GetBytesReserved()) / 1024.0 << " reserved" << std::endl
+              << "checksum: " << checksum.str() << std::endl;
+
+    if (outputPath.empty()) {return;}
+
+    std::ofstream outputFile(outputPath);
+    outputFile << std::fixed << std::setprecision(3)
+               << "{\n"
+               << "  \"frames\": " << frames << ",\n"
+               << "  \"seed\": " << seed << ",\n"
+               << "  \"frame_time_p50_ms\": " << p50 << ",\n"
+               << "  \"frame_time_p95_ms\": " << p95 << ",\n"
+               << "  \"frame_time_p99_ms\": " << p99 << ",\n"
+               << "  \"frame_time_max_ms\": " << maximum << ",\n"
+               << "  \"allocations\": " << (countsAllocations ? std::to_string(frameAllocations) : "null") << ",\n"
+               << "  \"bytes_allocated\": " << (countsAllocations ? std::to_string(frameBytes) : "null") << ",\n"
+               << "  \"lua_gc_average_ms\": " << gcAverage << ",\n"
+               << "  \"lua_gc_max_ms\": " << LuaGC::GetMaxCollectionTime() << ",\n"
+               << "  \"lua_heap_kb\": " << heapKilobytes << ",\n"
+               << "  \"lua_heap_peak_kb\": " << peakHeapKilobytes << ",\n"
+               << "  \"lua_size_classes\": [";
+    for (int i = 0; i < LuaAllocator::GetSizeClassCount(); i++)
+    {
+        const LuaSizeClassStats& sizeClass = LuaAllocator::GetSizeClassStats(i);
+        outputFile << (i == 0 ? "\n" : ",\n")
+                   << "    {\"block_size\": " << sizeClass.blockSize
+                   << ", \"bytes_in_use\": " << sizeClass.GetBytesInUse()
+                   << ", \"peak_bytes_in_use\": " << sizeClass.GetPeakBytesInUse()
+                   << ", \"bytes_reserved\": " << sizeClass.bytesReserved
+                   << ", \"allocations\": " << sizeClass.allocations << "}";
+    }
+    const LuaLargeBlockStats& largeBlocks = LuaAllocator::GetLargeBlockStats();
+    outputFile << "\n  ],\n"
+               << "  \"lua_large_blocks\": {\"bytes_in_use\": " << largeBlocks.bytesInUse
+               << ", \"peak_bytes_in_use\": " << largeBlocks.peakBytesInUse
+               << ", \"allocations\": " << largeBlocks.allocations << "},\n"
+               << "  \"checksum\": \"" << checksum.str() << "\"\n"
+               << "}\n";
+}
@@ -0,0 +1,194 @@
+//
+//  BytecodeCache.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/22/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <iostream>
+
+#include "BytecodeCache.h"
+#include "JobSystem.h"
+
+bool BytecodeCache::enabled = true;
+const std::string BytecodeCache::cacheDirectoryPath = "resources/.bytecode_cache";
+
+// Reads the cache settings, has to run after game.config is loaded
+void BytecodeCache::Init()
+{
+    if (EngineUtils::game_config.HasMember("lua_bytecode_cache"))
+    {
+        enabled = EngineUtils::game_config["lua_bytecode_cache"].GetBool();
+    }
+}
+
+// Returns every script compiled, in the order given, using cached bytecode where it's still valid
+std::vector<CompiledScript> BytecodeCache::Compile(const std::vector<std::string>& paths)
+{
+    std::vector<CompiledScript> scripts(paths.size());
+    std::vector<int> staleScripts;
+    
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        CompiledScript& script = scripts[i];
+        script.path = paths[i];
+        
+        std::ifstream sourceFile(script.path, std::ios::binary);
+        std::stringstream source;
+        source << sourceFile.rdbuf();
+        script.source = source.str();
+        script.sourceHash = HashSource(script.source);
+        
+        if (!enabled || !ReadEntry(script))
+        {
+            staleScripts.push_back(static_cast<int>(i));
+        }
+    }
+    
+    // Each script gets its own Lua state, so they can all compile at once
+    JobSystem::ParallelFor(static_cast<int>(staleScripts.size()), 1, [&scripts, &staleScripts](int start, int end)
+    {
+        for (int i = start; i < end; i++)
+        {
+            CompileSource(scripts[staleScripts[i]]);
+        }
+    });
+    
+    if (enabled && !staleScripts.empty())
+    {
+        std::error_code error;
+        std::filesystem::create_directories(cacheDirectoryPath, error);
+        for (int i : staleScripts)
+        {
+            if (!scripts[i].bytecode.empty()) {WriteEntry(scripts[i]);}
+        }
+    }
+    
+    return scripts;
+}
+
+// Runs a compiled script in the given Lua state, falling back to its source if the bytecode won't load.
+// Returns LUA_OK or the Lua error code with the message on top of the stack like luaL_dofile
+int BytecodeCache::Run(lua_State* luaState, const CompiledScript& script)
+{
+    // Chunk names start with @ so errors name the file like luaL_dofile does
+    std::string chunkName = "@" + script.path;
+    
+    int status = LUA_ERRSYNTAX;
+    if (!script.bytecode.empty())
+    {
+        status = luaL_loadbufferx(luaState, script.bytecode.data(), script.bytecode.size(), chunkName.c_str(), "b");
+        if (status != LUA_OK) {lua_pop(luaState, 1);}
+    }
+    if (status != LUA_OK)
+    {
+        status = luaL_loadbufferx(luaState, script.source.data(), script.source.size(), chunkName.c_str(), "t");
+        if (status != LUA_OK) {return status;}
+    }
+    
+    return lua_pcall(luaState, 0, 0, 0);
+}
+
+// Hashes a script's source (FNV-1a)
+uint64_t BytecodeCache::HashSource(const std::string& source)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char character : source)
+    {
+        hash ^= character;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Returns the path of the cache entry for a script
+std::string BytecodeCache::GetEntryPath(const std::string& scriptPath)
+{
+    return cacheDirectoryPath + "/" + std::filesystem::path(scriptPath).stem().string() + ".luac";
+}
+
+// Loads a script's bytecode from its cache entry, returns false if the entry is missing or was made from other source
+bool BytecodeCache::ReadEntry(CompiledScript& script)
+{
+    std::ifstream entryFile(GetEntryPath(script.path), std::ios::binary);
+    if (!entryFile.is_open()) {return false;}
+    
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t sourceHash = 0;
+    uint64_t sourceSize = 0;
+    entryFile.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    entryFile.read(reinterpret_cast<char*>(&version), sizeof(version));
+    entryFile.read(reinterpret_cast<char*>(&sourceHash), sizeof(sourceHash));
+    entryFile.read(reinterpret_cast<char*>(&sourceSize), sizeof(sourceSize));
+    
+    // The source size is checked as well so a hash collision alone can't load the wrong script
+    if (!entryFile || magic != CACHE_MAGIC || version != CACHE_VERSION ||
+        sourceHash != script.sourceHash || sourceSize != script.source.size())
+    {
+        return false;
+    }
+    
+    std::stringstream bytecode;
+    bytecode << entryFile.rdbuf();
+    script.bytecode = bytecode.str();
+    script.fromCache = !script.bytecode.empty();
+    return script.fromCache;
+}
+
+// Writes a script's bytecode to its cache entry
+void BytecodeCache::WriteEntry(const CompiledScript& script)
+{
+    // Written to a temporary file first so a game quitting halfway through never leaves a broken entry behind
+    std::string entryPath = GetEntryPath(script.path);
+    std::string temporaryPath = entryPath + ".tmp";
+    {
+        std::ofstream entryFile(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!entryFile.is_open()) {return;}
+        
+        uint32_t magic = CACHE_MAGIC;
+        uint32_t version = CACHE_VERSION;
+        uint64_t sourceSize = script.source.size();
+        entryFile.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        entryFile.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        entryFile.write(reinterpret_cast<const char*>(&script.sourceHash), sizeof(script.sourceHash));
+        entryFile.write(reinterpret_cast<const char*>(&sourceSize), sizeof(sourceSize));
+        entryFile.write(script.bytecode.data(), static_cast<std::streamsize>(script.bytecode.size()));
+        if (!entryFile) {return;}
+    }
+    
+    // The cache is only a speed up, if it can't be written the scripts still load from source next time
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, entryPath, error);
+    if (error) {std::filesystem::remove(temporaryPath, error);}
+}
+
+// Compiles a script's source to bytecode in a Lua state of its own, safe to call from any thread
+void BytecodeCache::CompileSource(CompiledScript& script)
+{
+    // The engine's pooled allocator belongs to the main state, these use the standard one
+    lua_State* compileState = luaL_newstate();
+    if (compileState == nullptr) {return;}
+    
+    std::string chunkName = "@" + script.path;
+    if (luaL_loadbufferx(compileState, script.source.data(), script.source.size(), chunkName.c_str(), "t") == LUA_OK)
+    {
+        // Debug info is kept so errors still have file names and line numbers
+        lua_dump(compileState, WriteBytecode, &script.bytecode, 0);
+    }
+    
+    lua_close(compileState);
+}
+
+// The lua_Writer that lua_dump writes the bytecode through
+int BytecodeCache::WriteBytecode(lua_State*, const void* data, size_t size, void* output)
+{
+    static_cast<std::string*>(output)->append(static_cast<const char*>(data), size);
+    return 0;
+}
@@ -8,16 +8,26 @@
 //  School Email: mrjacob@umich.edu
 
 #include <stdio.h>
+#include <cstring>
 
 #include "ComponentDB.h"
 #include "SceneDB.h"
 #include "Actor.h"
+#include "ComponentRecord.h"
 #include "Application.h"
 #include "Input.h"
 #include "Renderer.h"
 #include "AudioDB.h"
 #include "EventBus.h"
+#include "CoroutineScheduler.h"
 #include "ParticleSystem.h"
+#include "Transform.h"
+#include "NativeComponentDB.h"
+#include "TimeHandler.h"
+#include "Profiler.h"
+#include "FramePacer.h"
+#include "LuaAllocator.h"
+#include "BytecodeCache.h"
 
 // Initializes variables
 void ComponentDB::Initialize()
@@ -30,7 +40,8 @@ void ComponentDB::Initialize()
 // Initializes the luaState
 void ComponentDB::InitializeState()
 {
-    luaState = luaL_newstate();
+    // Lua's small, short lived allocations come from the engine's size class pools instead of realloc
+    luaState = LuaAllocator::NewState();
     luaL_openlibs(luaState);
 }
 
@@ -43,6 +54,7 @@ void ComponentDB::InitializeFunctions()
         .beginNamespace("Debug")
         .addFunction("Log", ComponentDB::Log)
         .addFunction("LogError", ComponentDB::LogError)
+        .addFunction("WriteTrace", Profiler::WriteTrace)
         .endNamespace();
     
     /* Application static class (namespace) */
@@ -55,16 +67,33 @@ void ComponentDB::InitializeFunctions()
         .addFunction("RandomNumber", Application::RandomNumber)
         .endNamespace();
     
+    /* Time static class (namespace) */
+    luabridge::getGlobalNamespace(luaState)
+        .beginNamespace("Time")
+        .addFunction("GetDeltaTime", TimeHandler::GetDeltaTime)
+        .addFunction("GetFixedDeltaTime", TimeHandler::GetFixedDeltaTime)
+        .addFunction("GetInterpolationAlpha", TimeHandler::GetInterpolationAlpha)
+        .addFunction("GetTime", TimeHandler::GetTime)
+        .addFunction("GetAverageFrameTime", FramePacer::GetAverageFrameTime)
+        .addFunction("GetMinFrameTime", FramePacer::GetMinFrameTime)
+        .addFunction("GetMaxFrameTime", FramePacer::GetMaxFrameTime)
+        .addFunction("GetP99FrameTime", FramePacer::GetP99FrameTime)
+        .endNamespace();
+    
     /* Actor class */
     luabridge::getGlobalNamespace(luaState)
-        .beginClass<Actor>("Actor")
-        .addFunction("GetName", &Actor::GetName)
-        .addFunction("GetID", &Actor::GetID)
-        .addFunction("GetComponentByKey", &Actor::GetComponentByKey)
-        .addFunction("GetComponent", &Actor::GetComponent)
-        .addFunction("GetComponents", &Actor::GetComponents)
-        .addFunction("AddComponent", &Actor::AddComponent)
-        .addFunction("RemoveComponent", &Actor::RemoveComponent)
+        .beginClass<ActorRef>("Actor")
+        .addFunction("GetName", &ActorRef::GetName)
+        .addFunction("GetID", &ActorRef::GetID)
+        .addFunction("GetComponentByKey", &ActorRef::GetComponentByKey)
+        .addFunction("GetComponent", &ActorRef::GetComponent)
+        .addFunction("GetComponents", &ActorRef::GetComponents)
+        .addFunction("AddComponent", &ActorRef::AddComponent)
+        .addFunction("RemoveComponent", &ActorRef::RemoveComponent)
+        .addFunction("AddTag", &ActorRef::AddTag)
+        .addFunction("RemoveTag", &ActorRef::RemoveTag)
+        .addFunction("HasTag", &ActorRef::HasTag)
+        .addFunction("__eq", &ActorRef::operator==)
         .endClass();
     
     /* Actor static class (namespace) */
@@ -72,7 +101,10 @@ void ComponentDB::InitializeFunctions()
         .beginNamespace("Actor")
         .addFunction("Find", SceneDB::FindActorWithName)
         .addFunction("FindAll", SceneDB::FindAllActorsWithName)
+        .addFunction("FindWithTag", SceneDB::FindActorWithTag)
+        .addFunction("FindAllWithTag", SceneDB::FindAllActorsWithTag)
         .addFunction("Instantiate", SceneDB::Instantiate)
+        .addFunction("InstantiateMany", SceneDB::InstantiateMany)
         .addFunction("Destroy", SceneDB::Destroy)
         .endNamespace();
     
@@ -127,6 +159,7 @@ void ComponentDB::InitializeFunctions()
         .addFunction("DrawUIEx", Renderer::DrawUIEx)
         .addFunction("Draw", Renderer::Draw)
         .addFunction("DrawEx", Renderer::DrawEx)
+        .addFunction("DrawTransform", Renderer::DrawTransform)
         .addFunction("DrawPixel", Renderer::DrawPixel)
         .endNamespace();
     
@@ -182,117 +215,127 @@ void ComponentDB::InitializeFunctions()
         .endClass();
     
     /* ParticleSystem class */
-    luabridge::getGlobalNamespace(luaState)
-        .beginClass<ParticleSystem>("ParticleSystem")
-        .addData("MAX_NUM_PARTICLES", &ParticleSystem::MAX_NUM_PARTICLES)
-        .addData("type", &ParticleSystem::type)
-        .addData("key", &ParticleSystem::key)
-        .addData("actor", &ParticleSystem::actor)
-        .addData("enabled", &ParticleSystem::enabled)
-        .addData("started", &ParticleSystem::started)
-        .addData("emitting", &ParticleSystem::emitting)
-        .addData("duration", &ParticleSystem::duration)
-        .addData("loop", &ParticleSystem::loop)
-        .addData("emission_rate", &ParticleSystem::emission_rate)
-        .addData("particle_lifetime", &ParticleSystem::particle_lifetime)
-        .addData("emitter_pos_x", &ParticleSystem::emitter_pos_x)
-        .addData("emitter_pos_y", &ParticleSystem::emitter_pos_y)
-        .addData("emission_range_x", &ParticleSystem::emission_range_x)
-        .addData("emission_range_y", &ParticleSystem::emission_range_y)
-        .addData("emission_direction", &ParticleSystem::emission_direction)
-        .addData("emission_direction_range", &ParticleSystem::emission_direction_range)
-        .addData("change_movement", &ParticleSystem::change_movement)
-        .addData("movement_pattern", &ParticleSystem::movement_pattern)
-        .addData("speed", &ParticleSystem::speed)
-        .addData("speed_sine_loop", &ParticleSystem::speed_sine_loop)
-        .addData("change_size", &ParticleSystem::change_size)
-        .addData("size_pattern", &ParticleSystem::size_pattern)
-        .addData("size_change_per_second", &ParticleSystem::size_change_per_second)
-        .addData("size_sine_loop", &ParticleSystem::size_sine_loop)
-        .addData("speed_sine_amplitude", &ParticleSystem::speed_sine_amplitude)
-        .addData("image", &ParticleSystem::image)
-        .addData("colors", &ParticleSystem::colors)
-        .addData("change_color", &ParticleSystem::change_color)
-        .addData("sorting_order", &ParticleSystem::sorting_order)
-        .addData("x", &ParticleSystem::x)
-        .addData("y", &ParticleSystem::y)
-        .addData("body_type", &ParticleSystem::body_type)
-        .addData("precise", &ParticleSystem::precise)
-        .addData("gravity_scale", &ParticleSystem::gravity_scale)
-        .addData("density", &ParticleSystem::density)
-        .addData("angular_friction", &ParticleSystem::angular_friction)
-        .addData("rotation", &ParticleSystem::rotation)
-        .addData("mass", &ParticleSystem::mass)
-        .addData("has_collider", &ParticleSystem::has_collider)        
-        .addData("collide_with_other_particles", &ParticleSystem::collide_with_other_particles)
-        .addData("collider_type", &ParticleSystem::collider_type)
-        .addData("starting_size", &ParticleSystem::starting_size)
-        .addData("friction", &ParticleSystem::friction)
-        .addData("bounciness", &ParticleSystem::bounciness)
-        .addFunction("StartEmitting", &ParticleSystem::StartEmitting)
-        .addFunction("StopEmitting", &ParticleSystem::StopEmitting)
-        .addFunction("OnStart", &ParticleSystem::OnStart)
-        .addFunction("OnUpdate", &ParticleSystem::OnUpdate)
-        .addFunction("OnDestroy", &ParticleSystem::OnDestroy)
-        .endClass();
+    NativeComponentDB::Declare<ParticleSystem>(luaState, "ParticleSystem")
+        .Field("MAX_NUM_PARTICLES", &ParticleSystem::MAX_NUM_PARTICLES)
+        .Field("emitting", &ParticleSystem::emitting)
+        .Field("duration", &ParticleSystem::duration)
+        .Field("loop", &ParticleSystem::loop)
+        .Field("emission_rate", &ParticleSystem::emission_rate)
+        .Field("particle_lifetime", &ParticleSystem::particle_lifetime)
+        .Field("emitter_pos_x", &ParticleSystem::emitter_pos_x)
+        .Field("emitter_pos_y", &ParticleSystem::emitter_pos_y)
+        .Field("emission_range_x", &ParticleSystem::emission_range_x)
+        .Field("emission_range_y", &ParticleSystem::emission_range_y)
+        .Field("emission_direction", &ParticleSystem::emission_direction)
+        .Field("emission_direction_range", &ParticleSystem::emission_direction_range)
+        .Field("change_movement", &ParticleSystem::change_movement)
+        .Field("movement_pattern", &ParticleSystem::movement_pattern)
+        .Field("speed", &ParticleSystem::speed)
+        .Field("speed_sine_loop", &ParticleSystem::speed_sine_loop)
+        .Field("change_size", &ParticleSystem::change_size)
+        .Field("size_pattern", &ParticleSystem::size_pattern)
+        .Field("size_change_per_second", &ParticleSystem::size_change_per_second)
+        .Field("size_sine_loop", &ParticleSystem::size_sine_loop)
+        .Field("speed_sine_amplitude", &ParticleSystem::speed_sine_amplitude)
+        .Field("image", &ParticleSystem::image)
+        .Field("colors", &ParticleSystem::colors)
+        .Field("change_color", &ParticleSystem::change_color)
+        .Field("sorting_order", &ParticleSystem::sorting_order)
+        .Field("x", &ParticleSystem::x)
+        .Field("y", &ParticleSystem::y)
+        .Field("body_type", &ParticleSystem::body_type)
+        .Field("precise", &ParticleSystem::precise)
+        .Field("gravity_scale", &ParticleSystem::gravity_scale)
+        .Field("density", &ParticleSystem::density)
+        .Field("angular_friction", &ParticleSystem::angular_friction)
+        .Field("rotation", &ParticleSystem::rotation)
+        .Field("mass", &ParticleSystem::mass)
+        .Field("has_collider", &ParticleSystem::has_collider)
+        .Field("collide_with_other_particles", &ParticleSystem::collide_with_other_particles)
+        .Field("collider_type", &ParticleSystem::collider_type)
+        .Field("starting_size", &ParticleSystem::starting_size)
+        .Field("friction", &ParticleSystem::friction)
+        .Field("bounciness", &ParticleSystem::bounciness)
+        .Function("StartEmitting", &ParticleSystem::StartEmitting)
+        .Function("StopEmitting", &ParticleSystem::StopEmitting)
+        .Function("OnStart", &ParticleSystem::OnStart)
+        .Function("OnUpdate", &ParticleSystem::OnUpdate)
+        .ParallelUpdate(&ParticleSystem::UpdateParallel)
+        .Function("OnDestroy", &ParticleSystem::OnDestroy)
+        .End();
     
     /* Rigidbody class */
-    luabridge::getGlobalNamespace(luaState)
-        .beginClass<Rigidbody>("Rigidbody")
-        .addData("enabled", &Rigidbody::enabled)
-        .addData("started", &Rigidbody::started)
-        .addData("key", &Rigidbody::key)
-        .addData("type", &Rigidbody::type)
-        .addData("actor", &Rigidbody::actor)
-        .addData("x", &Rigidbody::x)
-        .addData("y", &Rigidbody::y)
-        .addData("body_type", &Rigidbody::body_type)
-        .addData("precise", &Rigidbody::precise)
-        .addData("gravity_scale", &Rigidbody::gravity_scale)
-        .addData("density", &Rigidbody::density)
-        .addData("angular_friction", &Rigidbody::angular_friction)
-        .addData("rotation", &Rigidbody::rotation)
+    NativeComponentDB::Declare<Rigidbody>(luaState, "Rigidbody")
+        .Field("x", &Rigidbody::x)
+        .Field("y", &Rigidbody::y)
+        .Field("body_type", &Rigidbody::body_type)
+        .Field("precise", &Rigidbody::precise)
+        .Field("gravity_scale", &Rigidbody::gravity_scale)
+        .Field("density", &Rigidbody::density)
+        .Field("angular_friction", &Rigidbody::angular_friction)
+        .Field("rotation", &Rigidbody::rotation)
     
         // Collider
-        .addData("has_collider", &Rigidbody::has_collider)
-        .addData("width", &Rigidbody::width)
-        .addData("height", &Rigidbody::height)
-        .addData("radius", &Rigidbody::radius)
-        .addData("friction", &Rigidbody::friction)
-        .addData("bounciness", &Rigidbody::bounciness)
-        .addData("collider_type", &Rigidbody::collider_type)
+        .Field("has_collider", &Rigidbody::has_collider)
+        .Field("width", &Rigidbody::width)
+        .Field("height", &Rigidbody::height)
+        .Field("radius", &Rigidbody::radius)
+        .Field("friction", &Rigidbody::friction)
+        .Field("bounciness", &Rigidbody::bounciness)
+        .Field("collider_type", &Rigidbody::collider_type)
     
         // Trigger
-        .addData("has_trigger", &Rigidbody::has_trigger)
-        .addData("trigger_width", &Rigidbody::trigger_width)
-        .addData("trigger_height", &Rigidbody::trigger_height)
-        .addData("trigger_radius", &Rigidbody::trigger_radius)
-        .addData("trigger_type", &Rigidbody::trigger_type)
+        .Field("has_trigger", &Rigidbody::has_trigger)
+        .Field("trigger_width", &Rigidbody::trigger_width)
+        .Field("trigger_height", &Rigidbody::trigger_height)
+        .Field("trigger_radius", &Rigidbody::trigger_radius)
+        .Field("trigger_type", &Rigidbody::trigger_type)
 
         // Force
-        .addFunction("AddForce", &Rigidbody::AddForce)
+        .Function("AddForce", &Rigidbody::AddForce)
     
         // Setters
-        .addFunction("SetVelocity", &Rigidbody::SetVelocity)
-        .addFunction("SetPosition", &Rigidbody::SetPosition)
-        .addFunction("SetRotation", &Rigidbody::SetRotation)
-        .addFunction("SetAngularVelocity", &Rigidbody::SetAngularVelocity)
-        .addFunction("SetGravityScale", &Rigidbody::SetGravityScale)
-        .addFunction("SetUpDirection", &Rigidbody::SetUpDirection)
-        .addFunction("SetRightDirection", &Rigidbody::SetRightDirection)
+        .Function("SetVelocity", &Rigidbody::SetVelocity)
+        .Function("SetPosition", &Rigidbody::SetPosition)
+        .Function("SetRotation", &Rigidbody::SetRotation)
+        .Function("SetAngularVelocity", &Rigidbody::SetAngularVelocity)
+        .Function("SetGravityScale", &Rigidbody::SetGravityScale)
+        .Function("SetUpDirection", &Rigidbody::SetUpDirection)
+        .Function("SetRightDirection", &Rigidbody::SetRightDirection)
 
         // Getters
-        .addFunction("GetPosition", &Rigidbody::GetPosition)
-        .addFunction("GetRotation", &Rigidbody::GetRotation)
-        .addFunction("GetVelocity", &Rigidbody::GetVelocity)
-        .addFunction("GetAngularVelocity", &Rigidbody::GetAngularVelocity)
-        .addFunction("GetGravityScale", &Rigidbody::GetGravityScale)
-        .addFunction("GetUpDirection", &Rigidbody::GetUpDirection)
-        .addFunction("GetRightDirection", &Rigidbody::GetRightDirection)
+        .Function("GetPosition", &Rigidbody::GetPosition)
+        .Function("GetRotation", &Rigidbody::GetRotation)
+        .Function("GetVelocity", &Rigidbody::GetVelocity)
+        .Function("GetAngularVelocity", &Rigidbody::GetAngularVelocity)
+        .Function("GetGravityScale", &Rigidbody::GetGravityScale)
+        .Function("GetUpDirection", &Rigidbody::GetUpDirection)
+        .Function("GetRightDirection", &Rigidbody::GetRightDirection)
+        .Function("GetInterpolatedPosition", &Rigidbody::GetInterpolatedPosition)
+        .Function("GetInterpolatedRotation", &Rigidbody::GetInterpolatedRotation)
 
-        .addFunction("OnStart", &Rigidbody::OnStart)
-        .addFunction("OnDestroy", &Rigidbody::OnDestroy)
-        .endClass();
+        .Function("OnStart", &Rigidbody::OnStart)
+        .Function("OnDestroy", &Rigidbody::OnDestroy)
+        .End();
+    
+    /* Transform class */
+    NativeComponentDB::Declare<Transform>(luaState, "Transform")
+        .Property("x", &Transform::GetX, &Transform::SetX)
+        .Property("y", &Transform::GetY, &Transform::SetY)
+        .Property("rotation", &Transform::GetRotation, &Transform::SetRotation)
+        .Property("scale_x", &Transform::GetScaleX, &Transform::SetScaleX)
+        .Property("scale_y", &Transform::GetScaleY, &Transform::SetScaleY)
+    
+        .Function("GetPosition", &Transform::GetPosition)
+        .Function("SetPosition", &Transform::SetPosition)
+        .Function("GetWorldPosition", &Transform::GetWorldPosition)
+        .Function("GetWorldRotation", &Transform::GetWorldRotation)
+        .Function("GetWorldScale", &Transform::GetWorldScale)
+        .Function("SetParent", &Transform::SetParent)
+        .Function("GetParent", &Transform::GetParent)
+    
+        .Function("OnDestroy", &Transform::OnDestroy)
+        .End();
     
     /* Physics static Lua class */
     luabridge::getGlobalNamespace(luaState)
@@ -308,6 +351,9 @@ void ComponentDB::InitializeFunctions()
         .addFunction("Subscribe", EventBus::Subscribe)
         .addFunction("Unsubscribe", EventBus::Unsubscribe)
         .endNamespace();
+    
+    /* Coroutine static Lua class */
+    CoroutineScheduler::Initialize(luaState);
 }
 
 // Loads all of the components in the resources/component_types directory into componentTables
@@ -319,77 +365,67 @@ void ComponentDB::LoadComponents()
     // Fills up componentTables if the path exists
     if (std::filesystem::exists(componentDirectoryPath))
     {
+        std::vector<std::string> componentPaths;
         for (const auto& componentFile : std::filesystem::directory_iterator(componentDirectoryPath))
         {
-            if (componentFile.path() != componentDirectoryPath + "/.DS_Store")
+            if (componentFile.path() != componentDirectoryPath + "/.DS_Store" && componentFile.is_regular_file())
             {
-                std::string componentName = componentFile.path().stem().string();
-                
-                if (luaL_dofile(luaState, componentFile.path().string().c_str()) != LUA_OK)
-                {
-                    std::cout << "problem with lua file " << componentName;
-                    exit(0);
-                }
-                
-                componentTables.insert({
-                    componentName,
-                    std::make_shared<luabridge::LuaRef>(luabridge::getGlobal(luaState, componentName.c_str()))
-                });
+                componentPaths.push_back(componentFile.path().string());
             }
         }
+        
+        // Scripts that changed since the last run are compiled in parallel, the rest come straight out of the bytecode cache
+        std::vector<CompiledScript> scripts = BytecodeCache::Compile(componentPaths);
+        
+        for (const CompiledScript& script : scripts)
+        {
+            std::string componentName = std::filesystem::path(script.path).stem().string();
+            
+            if (BytecodeCache::Run(luaState, script) != LUA_OK)
+            {
+                std::cout << "problem with lua file " << componentName;
+                exit(0);
+            }
+            
+            componentTables.insert({
+                componentName,
+                std::make_shared<luabridge::LuaRef>(luabridge::getGlobal(luaState, componentName.c_str()))
+            });
+        }
     }
 }
 
 // Returns true if the given type is a C++ based component
 bool ComponentDB::IsComponentTypeCPP(std::string type)
 {
-    if (type == "Rigidbody" || type == "ParticleSystem") {return true;}
-    
-    return false;
+    return NativeComponentDB::FindType(type) != nullptr;
 }
 
 // Creates a C++ component and returns the LuaRef
 luabridge::LuaRef ComponentDB::NewCPPComponent(std::string type)
 {
-    if (type == "Rigidbody")
-    {
-        Rigidbody* rigidbody = new Rigidbody();
-        luabridge::LuaRef newComponent(luaState, rigidbody);
-        return newComponent;
-    }
+    const NativeComponentType* nativeType = NativeComponentDB::FindType(type);
+    if (nativeType == nullptr) {return luabridge::LuaRef(ComponentDB::luaState);}
     
-    if (type == "ParticleSystem")
-    {
-        ParticleSystem* particleSystem = new ParticleSystem();
-        luabridge::LuaRef newComponent(luaState, particleSystem);
-        return newComponent;
-    }
-    
-    return luabridge::LuaRef(ComponentDB::luaState);
+    return nativeType->create();
 }
 
 // Makes a new copy of the given CPP component and returns it
 luabridge::LuaRef ComponentDB::CopyCPPComponent(shared_ptr<luabridge::LuaRef> component, std::string type)
 {
-    // Creates and gets a reference to a new table on the Lua stack
-    lua_newtable(ComponentDB::luaState);
-    luabridge::LuaRef newComponent(luabridge::get<luabridge::LuaRef>(ComponentDB::luaState, -1));
+    const NativeComponentType* nativeType = NativeComponentDB::FindType(type);
+    if (nativeType == nullptr) {return luabridge::LuaRef(ComponentDB::luaState);}
     
-    if (ComponentDB::IsComponentTypeCPP((*component)["type"]))
-    {
-        if ((*component)["type"].tostring() == "Rigidbody")
-        {
-            Rigidbody* r = new Rigidbody((*component).cast<Rigidbody>());
-            newComponent = luabridge::LuaRef(ComponentDB::luaState, r);
-        }
-        else if ((*component)["type"].tostring() == "ParticleSystem")
-        {
-            ParticleSystem* p = new ParticleSystem((*component).cast<ParticleSystem>());
-            newComponent = luabridge::LuaRef(ComponentDB::luaState, p);
-        }
-    }
-    
-    return newComponent;
+    return nativeType->copy(*component);
+}
+
+// Creates a new table that inherits from parent_table and returns it
+luabridge::LuaRef ComponentDB::NewInstance(luabridge::LuaRef & parent_table)
+{
+    lua_newtable(luaState);
+    luabridge::LuaRef instance_table = luabridge::LuaRef::fromStack(luaState);
+    EstablishInheritance(instance_table, parent_table);
+    return instance_table;
 }
 
 // Get a component from componentTables based on the components name
@@ -406,17 +442,148 @@ std::shared_ptr<luabridge::LuaRef> ComponentDB::GetComponent(std::string compone
 // Establishes inheritance between two tables by setting one to be the metatable of another
 void ComponentDB::EstablishInheritance(luabridge::LuaRef & instance_table, luabridge::LuaRef & parent_table)
 {
-    /* We must create a metatable to establish inheritance in Lua */
-    luabridge::LuaRef new_metatable = luabridge::newTable(luaState);
-    new_metatable["__index"] = parent_table;
-    
     /* We must use the raw lua C-API (lua stack) to preform a "setmetatable" operation */
     instance_table.push(luaState);
-    new_metatable.push(luaState);
+    
+    /* We must create a metatable to establish inheritance in Lua */
+    // Sized for the parent, the record, __index, __newindex and the two flags
+    lua_createtable(luaState, 0, 6);
+    parent_table.push(luaState);
+    lua_rawsetp(luaState, -2, &parentKey);
+    
+    // Once the component has a record its flags are kept in the metatable, so lookups go to the metatable first and then on to the parent.
+    // Both are plain tables, so reading anything from a component never calls back into the engine
+    lua_pushvalue(luaState, -1);
+    lua_setfield(luaState, -2, "__index");
+    lua_pushcfunction(luaState, ComponentNewIndex);
+    lua_setfield(luaState, -2, "__newindex");
+    
+    lua_createtable(luaState, 0, 1);
+    parent_table.push(luaState);
+    lua_setfield(luaState, -2, "__index");
+    lua_setmetatable(luaState, -2);
+    
     lua_setmetatable(luaState, -2);
     lua_pop(luaState, 1);
 }
 
+// Points a Lua component at its record so "enabled" and "started" are written to it, nullptr detaches it
+void ComponentDB::AttachRecord(luabridge::LuaRef & instance_table, ComponentRecord* record)
+{
+    instance_table.push(luaState);
+    
+    // Tables that were never given a parent have no metatable, their flags stay in the table
+    if (lua_getmetatable(luaState, -1) == 0)
+    {
+        lua_pop(luaState, 1);
+        return;
+    }
+    
+    if (record != nullptr)
+    {
+        lua_pushlightuserdata(luaState, record);
+    }
+    else
+    {
+        lua_pushnil(luaState);
+    }
+    lua_rawsetp(luaState, -2, &recordKey);
+    
+    // A detached component reads its flags from itself or its parent again
+    lua_pushnil(luaState);
+    lua_setfield(luaState, -2, "enabled");
+    lua_pushnil(luaState);
+    lua_setfield(luaState, -2, "started");
+    
+    lua_pop(luaState, 2);
+    
+    if (record != nullptr)
+    {
+        SyncFlags(instance_table, *record);
+    }
+}
+
+// Copies a record's flags into its Lua component's metatable, where Lua reads them from
+void ComponentDB::SyncFlags(luabridge::LuaRef & instance_table, const ComponentRecord& record)
+{
+    instance_table.push(luaState);
+    if (!lua_istable(luaState, -1) || lua_getmetatable(luaState, -1) == 0)
+    {
+        lua_pop(luaState, 1);
+        return;
+    }
+    
+    lua_pushboolean(luaState, *record.enabled);
+    lua_setfield(luaState, -2, "enabled");
+    lua_pushboolean(luaState, *record.started);
+    lua_setfield(luaState, -2, "started");
+    
+    lua_pop(luaState, 2);
+}
+
+// Returns the record of the Lua component at the given stack index, nullptr for anything else
+ComponentRecord* ComponentDB::GetRecord(lua_State* state, int index)
+{
+    if (!lua_istable(state, index) || lua_getmetatable(state, index) == 0) {return nullptr;}
+    
+    lua_rawgetp(state, -1, &recordKey);
+    ComponentRecord* record = static_cast<ComponentRecord*>(lua_touserdata(state, -1));
+    lua_pop(state, 2);
+    return record;
+}
+
+// Returns a number unique to the given component type, numbered in the order types are first seen
+int ComponentDB::GetTypeIndex(const std::string& type)
+{
+    auto typeIndex = typeIndices.find(type);
+    if (typeIndex != typeIndices.end()) {return typeIndex->second;}
+    
+    int newIndex = static_cast<int>(typeIndices.size());
+    typeIndices[type] = newIndex;
+    return newIndex;
+}
+
+// __newindex for Lua components, sets the flags on the record and everything else on the component
+int ComponentDB::ComponentNewIndex(lua_State* state)
+{
+    // Stack: component, key, value
+    if (lua_type(state, 2) == LUA_TSTRING && lua_getmetatable(state, 1) != 0)
+    {
+        // Stack: component, key, value, metatable
+        lua_rawgetp(state, 4, &recordKey);
+        ComponentRecord* record = static_cast<ComponentRecord*>(lua_touserdata(state, -1));
+        lua_pop(state, 1);
+        
+        if (record != nullptr)
+        {
+            const char* key = lua_tostring(state, 2);
+            bool* flag = nullptr;
+            if (std::strcmp(key, "enabled") == 0)
+            {
+                flag = record->enabled;
+            }
+            else if (std::strcmp(key, "started") == 0)
+            {
+                flag = record->started;
+            }
+            
+            if (flag != nullptr)
+            {
+                // The metatable keeps a copy so Lua reads it without calling back into the engine
+                *flag = lua_toboolean(state, 3);
+                lua_pushvalue(state, 2);
+                lua_pushboolean(state, *flag);
+                lua_rawset(state, 4);
+                return 0;
+            }
+        }
+        lua_pop(state, 1);
+    }
+    
+    lua_rawset(state, 1);
+    return 0;
+}
+
 // Prints a debug message to cout
 void ComponentDB::Log(std::string message)
 {
@@ -0,0 +1,293 @@
+//
+//  ComponentRecord.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/14/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <iostream>
+#include <algorithm>
+
+#include "ComponentRecord.h"
+#include "ComponentDB.h"
+#include "PhysicsHandler.h"
+#include "NativeComponentDB.h"
+
+// The name of each lifecycle function in Lua, in the same order as LifecycleFunction
+static const char* LIFECYCLE_FUNCTION_NAMES[NUM_LIFECYCLE_FUNCTIONS] =
+{
+    "OnStart",
+    "OnUpdate",
+    "OnFixedUpdate",
+    "OnLateUpdate",
+    "OnDestroy",
+    "OnCollisionEnter",
+    "OnCollisionExit",
+    "OnTriggerEnter",
+    "OnTriggerExit",
+    "OnReset"
+};
+
+// Makes a record for a component, has to happen before the component's flags are set
+ComponentRecord::ComponentRecord(const std::string& key, const std::string& type, const luabridge::LuaRef& component)
+    : key(key), type(type), typeIndex(ComponentDB::GetTypeIndex(type)), component(std::make_shared<luabridge::LuaRef>(component))
+{
+    Register();
+}
+
+// Makes a record for a copy of source's component, it starts with source's lifecycle functions instead of looking them up
+ComponentRecord::ComponentRecord(const ComponentRecord& source, const luabridge::LuaRef& component)
+    : key(source.key), type(source.type), typeIndex(source.typeIndex), component(std::make_shared<luabridge::LuaRef>(component))
+{
+    Register();
+    
+    // A copy inherits everything from source until it sets something itself, so it has the same functions
+    if (source.resolved)
+    {
+        CopyFunctions(source);
+    }
+}
+
+ComponentRecord::~ComponentRecord()
+{
+    lua_State* luaState = ComponentDB::luaState;
+
+    // Lua can still be holding onto the component, so it keeps the last values of its flags
+    if (component->isTable())
+    {
+        ComponentDB::AttachRecord(*component, nullptr);
+        (*component)["enabled"] = ownEnabled;
+        (*component)["started"] = ownStarted;
+    }
+    // C++ components go back to their pool, the engine doesn't hand them to Lua anymore
+    else if (native != nullptr)
+    {
+        native->release(*component);
+    }
+
+    luaL_unref(luaState, LUA_REGISTRYINDEX, selfRef);
+    for (int functionRef : functionRefs)
+    {
+        luaL_unref(luaState, LUA_REGISTRYINDEX, functionRef);
+    }
+}
+
+// Keeps a reference to the component and finds its flags
+void ComponentRecord::Register()
+{
+    for (int& functionRef : functionRefs)
+    {
+        functionRef = LUA_NOREF;
+    }
+
+    component->push(ComponentDB::luaState);
+    selfRef = luaL_ref(ComponentDB::luaState, LUA_REGISTRYINDEX);
+
+    // Lua components find their flags through their metatable, C++ components already have them as members
+    if (component->isTable())
+    {
+        ComponentDB::AttachRecord(*component, this);
+    }
+    else
+    {
+        native = NativeComponentDB::FindType(type);
+        if (native != nullptr)
+        {
+            NativeComponent* base = native->getBase(*component);
+            enabled = &base->enabled;
+            started = &base->started;
+        }
+    }
+}
+
+// Takes references to the lifecycle functions source has resolved
+void ComponentRecord::CopyFunctions(const ComponentRecord& source)
+{
+    lua_State* luaState = ComponentDB::luaState;
+    
+    for (int i = 0; i < NUM_LIFECYCLE_FUNCTIONS; i++)
+    {
+        if (source.functionRefs[i] == LUA_NOREF) {continue;}
+        
+        lua_rawgeti(luaState, LUA_REGISTRYINDEX, source.functionRefs[i]);
+        functionRefs[i] = luaL_ref(luaState, LUA_REGISTRYINDEX);
+    }
+    updatePolicy = source.updatePolicy;
+    updateInterval = source.updateInterval;
+    resolved = true;
+}
+
+// Looks up the component's lifecycle functions and keeps references to them, only the first call does anything
+void ComponentRecord::ResolveFunctions()
+{
+    if (resolved) {return;}
+    resolved = true;
+
+    lua_State* luaState = ComponentDB::luaState;
+    lua_rawgeti(luaState, LUA_REGISTRYINDEX, selfRef);
+
+    for (int i = 0; i < NUM_LIFECYCLE_FUNCTIONS; i++)
+    {
+        lua_getfield(luaState, -1, LIFECYCLE_FUNCTION_NAMES[i]);
+        if (lua_isfunction(luaState, -1))
+        {
+            functionRefs[i] = luaL_ref(luaState, LUA_REGISTRYINDEX);
+        }
+        else
+        {
+            lua_pop(luaState, 1);
+        }
+    }
+    
+    // Only Lua components can set an update policy, C++ components that want to be throttled update in batches
+    if (lua_istable(luaState, -1))
+    {
+        ResolveUpdatePolicy();
+    }
+
+    lua_pop(luaState, 1);
+}
+
+// Reads "update_policy" and "update_interval" from the component on top of the Lua stack
+void ComponentRecord::ResolveUpdatePolicy()
+{
+    lua_State* luaState = ComponentDB::luaState;
+    
+    lua_getfield(luaState, -1, "update_policy");
+    if (lua_type(luaState, -1) == LUA_TSTRING)
+    {
+        std::string policy = lua_tostring(luaState, -1);
+        if (policy == "every_n_frames")
+        {
+            updatePolicy = UPDATE_EVERY_N_FRAMES;
+        }
+        else if (policy == "distance")
+        {
+            updatePolicy = UPDATE_BY_DISTANCE;
+        }
+        else if (policy == "dormant_off_camera")
+        {
+            updatePolicy = UPDATE_DORMANT_OFF_CAMERA;
+        }
+        else if (policy != "every_frame")
+        {
+            std::cout << "error: unknown update_policy " << policy << " on component " << key;
+            exit(0);
+        }
+    }
+    lua_pop(luaState, 1);
+    
+    // Throttled components default to every fourth frame at most
+    updateInterval = updatePolicy == UPDATE_EVERY_FRAME ? 1 : 4;
+    lua_getfield(luaState, -1, "update_interval");
+    if (lua_isnumber(luaState, -1))
+    {
+        updateInterval = std::max(1, static_cast<int>(lua_tonumber(luaState, -1)));
+    }
+    lua_pop(luaState, 1);
+}
+
+// Puts a component recycled from a destroyed actor back the way source is, so it can be used again.
+// Lua components lose everything set on them and inherit from their type again, C++ components are copied from source.
+void ComponentRecord::Reset(const ComponentRecord& source)
+{
+    lua_State* luaState = ComponentDB::luaState;
+    
+    if (component->isTable())
+    {
+        // Clears the component's own fields, its metatable still points at the same parent
+        lua_rawgeti(luaState, LUA_REGISTRYINDEX, selfRef);
+        lua_pushnil(luaState);
+        while (lua_next(luaState, -2) != 0)
+        {
+            lua_pop(luaState, 1);
+            lua_pushvalue(luaState, -1);
+            lua_pushnil(luaState);
+            lua_rawset(luaState, -4);
+        }
+        lua_pop(luaState, 1);
+    }
+    else if (native != nullptr)
+    {
+        native->reset(*component, *source.component);
+    }
+    
+    SetEnabled(*source.enabled);
+    SetStarted(false);
+    removed = false;
+    initOrder = -1;
+    
+    // Functions set on the component itself are gone, so it has source's functions again
+    for (int& functionRef : functionRefs)
+    {
+        luaL_unref(luaState, LUA_REGISTRYINDEX, functionRef);
+        functionRef = LUA_NOREF;
+    }
+    resolved = false;
+    updatePolicy = UPDATE_EVERY_FRAME;
+    updateInterval = 1;
+    
+    if (source.resolved)
+    {
+        CopyFunctions(source);
+    }
+}
+
+// Sets the component's flags, Lua components get a copy in their metatable where Lua reads them from
+void ComponentRecord::SetEnabled(bool value)
+{
+    *enabled = value;
+    if (native == nullptr) {ComponentDB::SyncFlags(*component, *this);}
+}
+
+void ComponentRecord::SetStarted(bool value)
+{
+    *started = value;
+    if (native == nullptr) {ComponentDB::SyncFlags(*component, *this);}
+}
+
+// Calls a lifecycle function on the component, errors are printed with the actor's name
+void ComponentRecord::Call(LifecycleFunction function, const std::string& actorName)
+{
+    lua_State* luaState = ComponentDB::luaState;
+    lua_rawgeti(luaState, LUA_REGISTRYINDEX, functionRefs[function]);
+    lua_rawgeti(luaState, LUA_REGISTRYINDEX, selfRef);
+    Invoke(1, actorName);
+}
+
+void ComponentRecord::Call(LifecycleFunction function, const Collision& col, const std::string& actorName)
+{
+    lua_State* luaState = ComponentDB::luaState;
+    lua_rawgeti(luaState, LUA_REGISTRYINDEX, functionRefs[function]);
+    lua_rawgeti(luaState, LUA_REGISTRYINDEX, selfRef);
+    luabridge::Stack<Collision>::push(luaState, col);
+    Invoke(2, actorName);
+}
+
+void ComponentRecord::Call(LifecycleFunction function, float deltaTime, const std::string& actorName)
+{
+    lua_State* luaState = ComponentDB::luaState;
+    lua_rawgeti(luaState, LUA_REGISTRYINDEX, functionRefs[function]);
+    lua_rawgeti(luaState, LUA_REGISTRYINDEX, selfRef);
+    lua_pushnumber(luaState, deltaTime);
+    Invoke(2, actorName);
+}
+
+// Calls the function on the Lua stack with the component and numArgs - 1 other arguments
+void ComponentRecord::Invoke(int numArgs, const std::string& actorName)
+{
+    lua_State* luaState = ComponentDB::luaState;
+    if (lua_pcall(luaState, numArgs, 0, 0) != LUA_OK)
+    {
+        const char* message = lua_tostring(luaState, -1);
+        std::string errorMessage = message != nullptr ? message : "error object is not a string";
+        lua_pop(luaState, 1);
+#ifdef _WIN32
+        std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
+#endif
+        std::cout << "\033[31m" << actorName << " : " << errorMessage << "\033[0m" << std::endl;
+    }
+}
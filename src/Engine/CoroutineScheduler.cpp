@@ -0,0 +1,455 @@
+//
+//  CoroutineScheduler.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/19/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "CoroutineScheduler.h"
+#include "ComponentDB.h"
+#include "ComponentRecord.h"
+#include "Actor.h"
+#include "Application.h"
+#include "TimeHandler.h"
+
+// TimingWheel Class
+// Schedules id for the given tick, ids already due go straight into ready
+void TimingWheel::Insert(uint32_t id, uint64_t tick, std::vector<uint32_t>& ready)
+{
+    if (tick <= now)
+    {
+        ready.push_back(id);
+        return;
+    }
+    
+    // The level is decided by the highest bit where tick and now differ,
+    // so the timer is looked at again when every finer level has wrapped around to it
+    uint64_t differentBits = tick ^ now;
+    int level = 0;
+    while (level < LEVELS && (differentBits >> (SLOT_BITS * (level + 1))) != 0)
+    {
+        level++;
+    }
+    
+    if (level == LEVELS)
+    {
+        overflow.push_back({id, tick});
+    }
+    else
+    {
+        slots[level][(tick >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back({id, tick});
+    }
+    count++;
+}
+
+// Moves time forward to tick and appends every id that came due to ready, in the order they were due
+void TimingWheel::Advance(uint64_t tick, std::vector<uint32_t>& ready)
+{
+    while (now < tick)
+    {
+        // Nothing is waiting, so there is nothing to step through
+        if (count == 0)
+        {
+            now = tick;
+            return;
+        }
+        
+        now++;
+        
+        // Finds the coarsest level whose slot came up this tick
+        int topLevel = 0;
+        while (topLevel < LEVELS && (now & ((1ull << (SLOT_BITS * (topLevel + 1))) - 1)) == 0)
+        {
+            topLevel++;
+        }
+        
+        // Coarse levels go first so their timers can keep moving down in the same tick
+        if (topLevel == LEVELS)
+        {
+            Cascade(overflow, ready);
+            topLevel = LEVELS - 1;
+        }
+        for (int level = topLevel; level >= 1; level--)
+        {
+            Cascade(slots[level][(now >> (SLOT_BITS * level)) & (SLOTS - 1)], ready);
+        }
+        
+        std::vector<Timer>& due = slots[0][now & (SLOTS - 1)];
+        for (const Timer& timer : due)
+        {
+            ready.push_back(timer.id);
+        }
+        count -= due.size();
+        due.clear();
+    }
+}
+
+// Takes every timer out of the list and inserts it again, which moves it down to a finer level
+void TimingWheel::Cascade(std::vector<Timer>& timers, std::vector<uint32_t>& ready)
+{
+    if (timers.empty()) {return;}
+    
+    std::vector<Timer> moving;
+    moving.swap(timers);
+    count -= moving.size();
+    
+    for (const Timer& timer : moving)
+    {
+        Insert(timer.id, timer.tick, ready);
+    }
+}
+
+// CoroutineScheduler Class
+// Adds the Coroutine namespace to Lua
+void CoroutineScheduler::Initialize(lua_State* state)
+{
+    luaState = state;
+    
+    luabridge::getGlobalNamespace(luaState)
+        .beginNamespace("Coroutine")
+        .addCFunction("Start", Start)
+        .addCFunction("Stop", Stop)
+        .addCFunction("WaitSeconds", WaitSeconds)
+        .addCFunction("WaitFrames", WaitFrames)
+        .addCFunction("WaitForEvent", WaitForEvent)
+        .endNamespace();
+}
+
+// Resumes every coroutine that is due this frame
+void CoroutineScheduler::Update()
+{
+    frameWheel.Advance(static_cast<uint64_t>(Application::GetFrame()), readyCoroutines);
+    timeWheel.Advance(GetTimeTick(), readyCoroutines);
+    if (readyCoroutines.empty()) {return;}
+    
+    // Coroutines that come due while these run wait for the next update
+    resumingCoroutines.swap(readyCoroutines);
+    for (uint32_t handle : resumingCoroutines)
+    {
+        Coroutine* coroutine = Get(handle);
+        if (coroutine == nullptr || !coroutine->waiting) {continue;}
+        
+        if (!IsOwnerAlive(*coroutine))
+        {
+            Free(handle);
+            continue;
+        }
+        
+        int numArgs = 0;
+        if (coroutine->resumeValueRef != LUA_NOREF)
+        {
+            lua_rawgeti(luaState, LUA_REGISTRYINDEX, coroutine->resumeValueRef);
+            lua_xmove(luaState, coroutine->thread, 1);
+            luaL_unref(luaState, LUA_REGISTRYINDEX, coroutine->resumeValueRef);
+            coroutine->resumeValueRef = LUA_NOREF;
+            numArgs = 1;
+        }
+        
+        coroutine->waiting = false;
+        Resume(handle, numArgs);
+    }
+    resumingCoroutines.clear();
+}
+
+// Wakes the coroutines waiting on an event, they are resumed with the event object on the next update
+void CoroutineScheduler::NotifyEvent(const std::string& eventType, const luabridge::LuaRef& eventObject)
+{
+    auto waiters = eventWaiters.find(eventType);
+    if (waiters == eventWaiters.end()) {return;}
+    
+    for (uint32_t handle : waiters->second)
+    {
+        Coroutine* coroutine = Get(handle);
+        if (coroutine == nullptr || !coroutine->waiting) {continue;}
+        
+        eventObject.push(luaState);
+        coroutine->resumeValueRef = luaL_ref(luaState, LUA_REGISTRYINDEX);
+        coroutine->waitingForEvent.clear();
+        readyCoroutines.push_back(handle);
+    }
+    eventWaiters.erase(waiters);
+}
+
+// Stops every coroutine the component started, called when it is removed or its actor is destroyed
+void CoroutineScheduler::StopOwnedBy(ComponentRecord* record)
+{
+    auto owned = coroutinesByOwner.find(record);
+    if (owned == coroutinesByOwner.end()) {return;}
+    
+    std::vector<uint32_t> handles = std::move(owned->second);
+    coroutinesByOwner.erase(owned);
+    
+    for (uint32_t handle : handles)
+    {
+        Coroutine* coroutine = Get(handle);
+        if (coroutine == nullptr) {continue;}
+        coroutine->ownerRecord = nullptr;
+        
+        // A coroutine that removed its own component is freed once it yields
+        if (handle == running)
+        {
+            coroutine->stopped = true;
+            continue;
+        }
+        
+        Free(handle);
+    }
+}
+
+// Coroutine.Start(component, function), starts running function straight away and returns a handle for Coroutine.Stop
+int CoroutineScheduler::Start(lua_State* state)
+{
+    luaL_checktype(state, 2, LUA_TFUNCTION);
+    
+    uint32_t index;
+    if (!freeCoroutines.empty())
+    {
+        index = freeCoroutines.back();
+        freeCoroutines.pop_back();
+    }
+    else
+    {
+        if (coroutines.size() >= INDEX_MASK)
+        {
+            return luaL_error(state, "too many coroutines running");
+        }
+        index = static_cast<uint32_t>(coroutines.size());
+        coroutines.emplace_back();
+    }
+    
+    Coroutine& coroutine = coroutines[index];
+    coroutine.active = true;
+    coroutine.waiting = false;
+    coroutine.stopped = false;
+    
+    uint32_t handle = (coroutine.generation << INDEX_BITS) | index;
+    
+    coroutine.thread = lua_newthread(state);
+    coroutine.threadRef = luaL_ref(state, LUA_REGISTRYINDEX);
+    
+    lua_pushvalue(state, 1);
+    coroutine.ownerRef = luaL_ref(state, LUA_REGISTRYINDEX);
+    
+    // Lua components are followed through their record, so the coroutine stops when they are removed or their actor is destroyed
+    ComponentRecord* record = ComponentDB::GetRecord(state, 1);
+    coroutine.ownerRecord = record;
+    coroutine.ownerInitOrder = record != nullptr ? record->initOrder : -1;
+    if (record != nullptr)
+    {
+        coroutinesByOwner[record].push_back(handle);
+    }
+    
+    // Errors are printed with the actor's name like errors in lifecycle functions
+    coroutine.actorName = "";
+    if (lua_istable(state, 1) || lua_isuserdata(state, 1))
+    {
+        lua_getfield(state, 1, "actor");
+        if (luabridge::Stack<ActorRef>::isInstance(state, -1))
+        {
+            Actor* actor = luabridge::Stack<ActorRef>::get(state, -1).Get();
+            if (actor != nullptr) {coroutine.actorName = actor->name;}
+        }
+        lua_pop(state, 1);
+    }
+    
+    lua_pushvalue(state, 2);
+    lua_xmove(state, coroutine.thread, 1);
+    Resume(handle, 0);
+    
+    lua_pushinteger(state, handle);
+    return 1;
+}
+
+// Coroutine.Stop(handle), does nothing if the coroutine already finished
+int CoroutineScheduler::Stop(lua_State* state)
+{
+    uint32_t handle = static_cast<uint32_t>(luaL_checkinteger(state, 1));
+    Coroutine* coroutine = Get(handle);
+    if (coroutine == nullptr) {return 0;}
+    
+    // A coroutine stopping itself is freed once it yields
+    if (handle == running)
+    {
+        coroutine->stopped = true;
+        return 0;
+    }
+    
+    Free(handle);
+    return 0;
+}
+
+// Coroutine.WaitSeconds(seconds), Coroutine.WaitFrames(frames) and Coroutine.WaitForEvent(event_type), only from inside a coroutine.
+// WaitForEvent returns the event object
+int CoroutineScheduler::WaitSeconds(lua_State* state)
+{
+    double seconds = luaL_checknumber(state, 1);
+    uint32_t handle = GetRunning(state, "WaitSeconds");
+    
+    // Always waits at least until the next update, even for no time at all
+    uint64_t ticks = static_cast<uint64_t>(std::max(1.0, std::ceil(seconds * 1000.0)));
+    coroutines[handle & INDEX_MASK].waiting = true;
+    timeWheel.Insert(handle, std::max(GetTimeTick(), timeWheel.GetNow()) + ticks, readyCoroutines);
+    
+    return lua_yield(state, 0);
+}
+
+int CoroutineScheduler::WaitFrames(lua_State* state)
+{
+    lua_Integer frames = luaL_optinteger(state, 1, 1);
+    uint32_t handle = GetRunning(state, "WaitFrames");
+    
+    uint64_t currentFrame = static_cast<uint64_t>(Application::GetFrame());
+    coroutines[handle & INDEX_MASK].waiting = true;
+    frameWheel.Insert(handle, std::max(currentFrame, frameWheel.GetNow()) + std::max<lua_Integer>(1, frames), readyCoroutines);
+    
+    return lua_yield(state, 0);
+}
+
+int CoroutineScheduler::WaitForEvent(lua_State* state)
+{
+    std::string eventType = luaL_checkstring(state, 1);
+    uint32_t handle = GetRunning(state, "WaitForEvent");
+    
+    Coroutine& coroutine = coroutines[handle & INDEX_MASK];
+    coroutine.waiting = true;
+    coroutine.waitingForEvent = eventType;
+    eventWaiters[eventType].push_back(handle);
+    
+    return lua_yield(state, 0);
+}
+
+// Returns the coroutine a handle points to if it is still running
+CoroutineScheduler::Coroutine* CoroutineScheduler::Get(uint32_t handle)
+{
+    if (handle == INVALID_HANDLE) {return nullptr;}
+    
+    uint32_t index = handle & INDEX_MASK;
+    if (index >= coroutines.size()) {return nullptr;}
+    
+    Coroutine& coroutine = coroutines[index];
+    if (!coroutine.active || coroutine.generation != (handle >> INDEX_BITS)) {return nullptr;}
+    
+    return &coroutine;
+}
+
+// Returns the handle of the coroutine calling a Wait function, errors in Lua if it wasn't started by Coroutine.Start
+uint32_t CoroutineScheduler::GetRunning(lua_State* state, const char* functionName)
+{
+    Coroutine* coroutine = Get(running);
+    if (coroutine == nullptr || coroutine->thread != state)
+    {
+        luaL_error(state, "Coroutine.%s can only be called from a coroutine started with Coroutine.Start", functionName);
+    }
+    return running;
+}
+
+// Returns false if the component that started the coroutine is gone
+bool CoroutineScheduler::IsOwnerAlive(const Coroutine& coroutine)
+{
+    if (coroutine.ownerRecord == nullptr) {return true;}
+    
+    lua_rawgeti(luaState, LUA_REGISTRYINDEX, coroutine.ownerRef);
+    ComponentRecord* record = ComponentDB::GetRecord(luaState, -1);
+    lua_pop(luaState, 1);
+    
+    return record != nullptr && !record->removed && record->initOrder == coroutine.ownerInitOrder;
+}
+
+// Resumes a coroutine with numArgs values already pushed onto its thread
+void CoroutineScheduler::Resume(uint32_t handle, int numArgs)
+{
+    lua_State* thread = coroutines[handle & INDEX_MASK].thread;
+    
+    uint32_t previous = running;
+    running = handle;
+    int numResults = 0;
+    int status = lua_resume(thread, luaState, numArgs, &numResults);
+    running = previous;
+    
+    // Starting coroutines inside this one can move it, so it is looked up again
+    Coroutine& coroutine = coroutines[handle & INDEX_MASK];
+    
+    if (status == LUA_YIELD)
+    {
+        lua_pop(thread, numResults);
+        if (coroutine.stopped)
+        {
+            Free(handle);
+        }
+        // A plain coroutine.yield() waits a frame
+        else if (!coroutine.waiting)
+        {
+            coroutine.waiting = true;
+            frameWheel.Insert(handle, std::max(static_cast<uint64_t>(Application::GetFrame()), frameWheel.GetNow()) + 1, readyCoroutines);
+        }
+        return;
+    }
+    
+    if (status != LUA_OK)
+    {
+        const char* message = lua_tostring(thread, -1);
+        std::string errorMessage = message != nullptr ? message : "error object is not a string";
+#ifdef _WIN32
+        std::replace(errorMessage.begin(), errorMessage.end(), '\\', '/');
+#endif
+        std::cout << "\033[31m" << coroutine.actorName << " : " << errorMessage << "\033[0m" << std::endl;
+    }
+    Free(handle);
+}
+
+// Lets go of a coroutine's Lua references and frees its handle
+void CoroutineScheduler::Free(uint32_t handle)
+{
+    uint32_t index = handle & INDEX_MASK;
+    Coroutine& coroutine = coroutines[index];
+    
+    luaL_unref(luaState, LUA_REGISTRYINDEX, coroutine.threadRef);
+    luaL_unref(luaState, LUA_REGISTRYINDEX, coroutine.ownerRef);
+    luaL_unref(luaState, LUA_REGISTRYINDEX, coroutine.resumeValueRef);
+    coroutine.thread = nullptr;
+    coroutine.threadRef = LUA_NOREF;
+    coroutine.ownerRef = LUA_NOREF;
+    coroutine.resumeValueRef = LUA_NOREF;
+    
+    // Lists keyed by the coroutine's owner or event would otherwise keep its handle until the owner is gone or the event is sent
+    if (coroutine.ownerRecord != nullptr)
+    {
+        RemoveHandle(coroutinesByOwner, coroutine.ownerRecord, handle);
+        coroutine.ownerRecord = nullptr;
+    }
+    if (!coroutine.waitingForEvent.empty())
+    {
+        RemoveHandle(eventWaiters, coroutine.waitingForEvent, handle);
+        coroutine.waitingForEvent.clear();
+    }
+    
+    // Handles still sitting in the wheels stop matching once the generation changes
+    coroutine.active = false;
+    coroutine.waiting = false;
+    coroutine.generation = (coroutine.generation + 1) & (0xFFFFFFFFu >> INDEX_BITS);
+    freeCoroutines.push_back(index);
+}
+
+// Takes a handle out of a list it is in, and the list out of its map once it's empty
+template <typename Key>
+void CoroutineScheduler::RemoveHandle(std::unordered_map<Key, std::vector<uint32_t>>& lists, const Key& key, uint32_t handle)
+{
+    auto list = lists.find(key);
+    if (list == lists.end()) {return;}
+    
+    list->second.erase(std::remove(list->second.begin(), list->second.end(), handle), list->second.end());
+    if (list->second.empty()) {lists.erase(list);}
+}
+
+// The current game time in time wheel ticks
+uint64_t CoroutineScheduler::GetTimeTick()
+{
+    return static_cast<uint64_t>(TimeHandler::time * 1000.0);
+}
@@ -12,6 +12,15 @@
 #include "Engine.h"
 
 #include "PhysicsHandler.h"
+#include "TimeHandler.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include "FramePacer.h"
+#include "LuaGC.h"
+#include "Benchmark.h"
+#include "ActorPool.h"
+#include "Transform.h"
+#include "BytecodeCache.h"
 
 // The default font to be used when rendering text
 string Engine::defaultFontName;
@@ -29,58 +38,177 @@ bool Engine::loadNewScene = false;
 // True if the game should be quit out of
 bool Engine::quit = false;
 
+// The number of frames to run before quitting, 0 runs until the game quits itself
+int Engine::frameLimit = 0;
+
+// The number of frames that have run so far
+int Engine::framesRun = 0;
+
 // Called to start the game
 int Engine::Game()
 {
     Initialize();
     
+    Uint64 startCounter = SDL_GetPerformanceCounter();
     int loopStatus = 0;
     
     while (loopStatus != 1) {
         loopStatus = GameLoop();
     }
+    
+    if (EngineUtils::headless)
+    {
+        PrintRunSummary(startCounter);
+    }
+    
+    JobSystem::Shutdown();
     return 0;
 }
 
+// Reads the command line options (--headless, --frames N, --benchmark, --game DIR, --replay FILE, --seed N, --benchmark-out FILE)
+void Engine::ParseArguments(int argc, char* argv[])
+{
+#ifdef GAME_ENGINE_HEADLESS
+    // The game_engine_headless target never opens a window
+    EngineUtils::headless = true;
+#endif
+    
+    std::string gameDirectory;
+    
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        
+        if (argument == "--headless")
+        {
+            EngineUtils::headless = true;
+        }
+        else if (argument == "--frames" && i + 1 < argc)
+        {
+            frameLimit = std::atoi(argv[i + 1]);
+            i++;
+        }
+        else if (argument == "--benchmark")
+        {
+            Benchmark::active = true;
+        }
+        else if (argument == "--replay" && i + 1 < argc)
+        {
+            Benchmark::SetReplay(argv[i + 1]);
+            i++;
+        }
+        else if (argument == "--seed" && i + 1 < argc)
+        {
+            Benchmark::seed = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+            Benchmark::seedSet = true;
+            i++;
+        }
+        else if (argument == "--benchmark-out" && i + 1 < argc)
+        {
+            Benchmark::outputPath = std::filesystem::absolute(argv[i + 1]).string();
+            i++;
+        }
+        else if (argument == "--game" && i + 1 < argc)
+        {
+            gameDirectory = argv[i + 1];
+            i++;
+        }
+    }
+    
+    // Games load everything relative to their own directory, so move there once every other path has been made absolute
+    if (!gameDirectory.empty())
+    {
+        if (!std::filesystem::is_directory(gameDirectory))
+        {
+            cout << "error: missing game directory " << gameDirectory;
+            exit(0);
+        }
+        std::filesystem::current_path(gameDirectory);
+    }
+}
+
 // The main loop of the game
 int Engine::GameLoop()
 {
-    if (quit)
+    if (quit || (frameLimit > 0 && framesRun >= frameLimit))
     {
         return 1;
     }
     
-    SDL_Event inputEvent;
-    while(Helper::SDL_PollEvent498(&inputEvent))
+    PROFILE_SCOPE("Frame");
+    
     {
-        Input::ProcessEvent(inputEvent);
-        switch (inputEvent.type) 
+        PROFILE_SCOPE("PollEvents");
+        SDL_Event inputEvent;
+        while(Helper::SDL_PollEvent498(&inputEvent))
         {
-            case SDL_QUIT:
-                quit = true;
-                break;
-                
-            default:
-                break;
+            Input::ProcessEvent(inputEvent);
+            switch (inputEvent.type) 
+            {
+                case SDL_QUIT:
+                    quit = true;
+                    break;
+                    
+                default:
+                    break;
+            }
         }
     }
     
     GetPlayerInput();
     
     // Clears the frame so new stuff can be drawn on it
-    SDL_RenderClear(Renderer::renderer);
+    if (!EngineUtils::headless)
+    {
+        SDL_RenderClear(Renderer::renderer);
+    }
+    
+    // Runs as many fixed simulation ticks as the time since the last frame calls for
+    TimeHandler::BeginFrame();
+    while (TimeHandler::ShouldRunFixedStep())
+    {
+        SceneDB::currentScene.FixedUpdateActors();
+        PhysicsHandler::Step(TimeHandler::fixedDeltaTime);
+    }
+    
+    // Transforms pick up where their bodies are and work out their world values before scripts read them
+    TransformHandler::UpdateWorldTransforms();
         
     SceneDB::currentScene.UpdateActors();
     
-    Renderer::Render();
-    
-    EventBus::ProcessSubEvents();
+    {
+        PROFILE_SCOPE("Renderer::Render");
+        Renderer::Render();
+    }
     
-    PhysicsHandler::Step();
+    {
+        PROFILE_SCOPE("EventBus::ProcessSubEvents");
+        EventBus::ProcessSubEvents();
+    }
     
     DrawGizmos();
-    Helper::SDL_RenderPresent498(Renderer::renderer);
+    
+    // Collects Lua garbage in the time left before the frame is presented
+    LuaGC::Step();
+    
+    {
+        PROFILE_SCOPE("FramePacer::EndFrame");
+        FramePacer::EndFrame();
+    }
+    
+    if (EngineUtils::headless)
+    {
+        // Nothing to present, but the frame count still drives input playback and Application.GetFrame
+        Helper::frame_number++;
+    }
+    else
+    {
+        PROFILE_SCOPE("SDL_RenderPresent498");
+        Helper::SDL_RenderPresent498(Renderer::renderer);
+    }
     Input::LateUpdate();
+    Benchmark::EndFrame();
+    framesRun++;
     
     // Loads a new scene if specified
     if (SceneDB::loadNewScene)
@@ -93,11 +221,16 @@ int Engine::GameLoop()
 
 // Initializes variables
 void Engine::Initialize()
-{    
+{
+    // Without a window SDL's event queue has to be started by hand
+    if (EngineUtils::headless)
+    {
+        SDL_Init(SDL_INIT_EVENTS | SDL_INIT_TIMER);
+    }
+    
     IMG_Init(IMG_INIT_PNG);
     TTF_Init();
     Input::Init();
-    ComponentDB::Initialize();
     
     // Confirm the existence of JSON files, and load them if they exist:
     EngineUtils::ConfirmDirectory("resources/", true);
@@ -105,6 +238,17 @@ void Engine::Initialize()
     // Game Config
     EngineUtils::ConfirmDirectory("resources/game.config", true);
     EngineUtils::ReadJsonFile("resources/game.config", EngineUtils::game_config);
+    Profiler::Init();
+    
+    // Starts the worker threads engine systems spread their work across
+    JobSystem::Init();
+    
+    // Component scripts are loaded once the workers are running so stale bytecode cache entries compile in parallel
+    BytecodeCache::Init();
+    ComponentDB::Initialize();
+    
+    // The Lua state exists and the component scripts are loaded, from here on Lua collects on the engine's schedule
+    LuaGC::Init(ComponentDB::luaState);
     
     // Rendering Config
     if (EngineUtils::ConfirmDirectory("resources/rendering.config", false))
@@ -117,6 +261,12 @@ void Engine::Initialize()
             Renderer::show_gizmos = EngineUtils::rendering_config["display_gizmos"].GetBool();
         }
         
+        // Build each frame's draw list on a worker thread while the next frame updates
+        if (EngineUtils::rendering_config.HasMember("pipelined_rendering"))
+        {
+            Renderer::pipelined = EngineUtils::rendering_config["pipelined_rendering"].GetBool();
+        }
+        
         // Assign window bounds their custom values IF they exist, otherwise they stay as the default
         if (EngineUtils::rendering_config.HasMember("x_resolution"))
         {
@@ -162,6 +312,9 @@ void Engine::Initialize()
         }
     }
     
+    // How frames are paced decides whether the renderer waits for vsync, so it's set up first
+    FramePacer::Init();
+    
     // Initialize the renderer class
     Renderer::RenderStart();
     
@@ -177,9 +330,31 @@ void Engine::Initialize()
     // Load Templates
     TemplateDB::LoadTemplates();
     
+    // Every actor's components are updated together unless the game asks for them to be grouped by type.
+    // Grouping changes the order components run in, so the autograder, which checks that order, always gets it ungrouped
+    if (EngineUtils::game_config.HasMember("group_updates_by_type") && !Helper::_autograder_mode)
+    {
+        SceneDB::groupUpdatesByType = EngineUtils::game_config["group_updates_by_type"].GetBool();
+    }
+    
+    // Actors this close to the camera's view still get every update, so components don't visibly wake up as they scroll in
+    if (EngineUtils::game_config.HasMember("update_lod_margin"))
+    {
+        SceneDB::updateLODMargin = EngineUtils::game_config["update_lod_margin"].GetFloat();
+    }
+    
+    // Destroyed actors are only reused by their templates if the game turns it on
+    if (EngineUtils::game_config.HasMember("actor_pooling"))
+    {
+        ActorPool::enabled = EngineUtils::game_config["actor_pooling"].GetBool();
+    }
+    
     // Load Scenes
     SceneDB::LoadScenes();
     
+    // Starts the simulation clock right before the first scene loads so loading time isn't simulated
+    TimeHandler::Init();
+    
     // Loads the starting scene
     if (EngineUtils::game_config.HasMember("initial_scene"))
     {
@@ -192,6 +367,13 @@ void Engine::Initialize()
         exit(0);
     }
     
+    // Benchmarks start measuring once the game has loaded, and stop when the replay runs out unless told otherwise
+    Benchmark::Init();
+    if (Benchmark::active && frameLimit == 0)
+    {
+        frameLimit = Benchmark::GetReplayLength();
+    }
+    
     // Loads the default font
     if (EngineUtils::game_config.HasMember("font"))
     {
@@ -227,3 +409,14 @@ void Engine::DrawGizmos()
         return;
     }
 }
+
+// Prints how fast the simulation ran, used by headless runs
+void Engine::PrintRunSummary(Uint64 startCounter)
+{
+    double seconds = static_cast<double>(SDL_GetPerformanceCounter() - startCounter) / static_cast<double>(SDL_GetPerformanceFrequency());
+    double framesPerSecond = seconds > 0.0 ? framesRun / seconds : 0.0;
+    double drawsPerFrame = framesRun > 0 ? static_cast<double>(Renderer::drawCallsSubmitted) / framesRun : 0.0;
+    
+    std::cout << "headless run: " << framesRun << " frames in " << seconds << "s ("
+              << framesPerSecond << " frames/s, " << drawsPerFrame << " draws/frame)" << std::endl;
+}
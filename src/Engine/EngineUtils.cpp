@@ -14,6 +14,9 @@
 rapidjson::Document EngineUtils::game_config;
 rapidjson::Document EngineUtils::rendering_config;
 
+// True when the engine runs without a window, renderer or audio device
+bool EngineUtils::headless = false;
+
 // Checks to make sure a directory exists, and throws an error if it doesn't and is maked as required.
 bool EngineUtils::ConfirmDirectory(std::string path, bool required)
 {
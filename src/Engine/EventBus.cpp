@@ -10,6 +10,7 @@
 #include <stdio.h>
 
 #include "EventBus.h"
+#include "CoroutineScheduler.h"
 
 std::unordered_map<std::string, std::vector<std::pair<std::shared_ptr<luabridge::LuaRef>, std::shared_ptr<luabridge::LuaRef>>>> EventBus::events;
 std::vector<SubEvent> EventBus::subEvents;
@@ -25,6 +26,9 @@ void EventBus::Publish(std::string event_type, luabridge::LuaRef event_object)
             (*function)(*subscriber.first, event_object);
         }
     }
+    
+    // Coroutines waiting on this event resume on the next update
+    CoroutineScheduler::NotifyEvent(event_type, event_object);
 }
 
 void EventBus::Subscribe(std::string event_type, luabridge::LuaRef component, luabridge::LuaRef function)
@@ -0,0 +1,201 @@
+//
+//  FramePacer.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/11/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <algorithm>
+#include <iostream>
+
+#include "FramePacer.h"
+#include "Helper.h"
+#include "Benchmark.h"
+
+PacingMode FramePacer::mode = PacingMode::VSync;
+double FramePacer::targetFrameRate = 60.0;
+
+Uint64 FramePacer::nextFrameDeadline = 0;
+Uint64 FramePacer::lastFrameEnd = 0;
+
+std::vector<float> FramePacer::frameTimes;
+int FramePacer::nextFrameTimeIndex = 0;
+
+// Reads the pacing settings, has to run before the renderer is created since vsync is a renderer flag
+void FramePacer::Init()
+{
+    bool frameRateSet = false;
+    if (EngineUtils::game_config.HasMember("frame_rate"))
+    {
+        int frameRate = EngineUtils::game_config["frame_rate"].GetInt();
+        if (frameRate > 0)
+        {
+            targetFrameRate = frameRate;
+            frameRateSet = true;
+        }
+    }
+
+    // A specific frame rate can't be hit by waiting on the display, so it gets the hybrid limiter
+    mode = frameRateSet ? PacingMode::Hybrid : PacingMode::VSync;
+
+    if (EngineUtils::rendering_config.IsObject() && EngineUtils::rendering_config.HasMember("frame_pacing"))
+    {
+        std::string pacing = EngineUtils::rendering_config["frame_pacing"].GetString();
+        if (pacing == "vsync")
+        {
+            mode = PacingMode::VSync;
+        }
+        else if (pacing == "uncapped")
+        {
+            mode = PacingMode::Uncapped;
+        }
+        else if (pacing == "hybrid")
+        {
+            mode = PacingMode::Hybrid;
+        }
+        else
+        {
+            std::cout << "error: unknown frame_pacing " << pacing;
+            exit(0);
+        }
+    }
+
+    // Headless runs have no display to wait on and benchmarks measure the engine, not the display, so they go as fast as they can
+    if (EngineUtils::headless || Benchmark::active)
+    {
+        mode = PacingMode::Uncapped;
+    }
+
+    // The pacer decides how long frames take now, so Helper shouldn't sleep as well
+    Helper::external_frame_pacing = true;
+
+    frameTimes.assign(FRAME_HISTORY, 0.0f);
+    nextFrameTimeIndex = 0;
+    lastFrameEnd = SDL_GetPerformanceCounter();
+    nextFrameDeadline = lastFrameEnd;
+}
+
+// Waits until it's time for the next frame to be presented and records how long this frame took
+void FramePacer::EndFrame()
+{
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+
+    // The autograder wants every frame as fast as possible
+    if (mode == PacingMode::Hybrid && !Helper::_autograder_mode)
+    {
+        Uint64 frameTicks = static_cast<Uint64>(static_cast<double>(frequency) / targetFrameRate);
+        nextFrameDeadline += frameTicks;
+
+        // If the frame ran long don't rush the following frames to catch up, just start again from now
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (nextFrameDeadline < now)
+        {
+            nextFrameDeadline = now;
+        }
+
+        WaitUntil(nextFrameDeadline);
+    }
+
+    Uint64 frameEnd = SDL_GetPerformanceCounter();
+    float frameMilliseconds = static_cast<float>(static_cast<double>(frameEnd - lastFrameEnd) * 1000.0 / static_cast<double>(frequency));
+    lastFrameEnd = frameEnd;
+
+    frameTimes[nextFrameTimeIndex] = frameMilliseconds;
+    nextFrameTimeIndex = (nextFrameTimeIndex + 1) % FRAME_HISTORY;
+}
+
+// How long EndFrame will wait if it's called now, 0 if frames aren't being held back
+double FramePacer::GetIdleSeconds()
+{
+    if (mode != PacingMode::Hybrid || Helper::_autograder_mode) {return 0.0;}
+
+    double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+    Uint64 deadline = nextFrameDeadline + static_cast<Uint64>(frequency / targetFrameRate);
+    Uint64 now = SDL_GetPerformanceCounter();
+    return deadline > now ? static_cast<double>(deadline - now) / frequency : 0.0;
+}
+
+// Sleeps and then spins until the deadline
+void FramePacer::WaitUntil(Uint64 deadline)
+{
+    double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+
+    while (true)
+    {
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= deadline) {return;}
+
+        double remainingSeconds = static_cast<double>(deadline - now) / frequency;
+        if (remainingSeconds > SPIN_SECONDS)
+        {
+            // Only sleep in whole milliseconds that can't overshoot the spin window
+            Uint32 sleepMilliseconds = static_cast<Uint32>((remainingSeconds - SPIN_SECONDS) * 1000.0);
+            if (sleepMilliseconds > 0)
+            {
+                SDL_Delay(sleepMilliseconds);
+                continue;
+            }
+        }
+
+        // Close enough to the deadline that sleeping would overshoot it
+        SDL_CPUPauseInstruction();
+    }
+}
+
+// Frame time statistics over the last FRAME_HISTORY frames, in milliseconds
+float FramePacer::GetAverageFrameTime()
+{
+    float total = 0.0f;
+    int count = 0;
+    for (float frameTime : frameTimes)
+    {
+        if (frameTime > 0.0f)
+        {
+            total += frameTime;
+            count++;
+        }
+    }
+    return count > 0 ? total / count : 0.0f;
+}
+
+float FramePacer::GetMinFrameTime()
+{
+    float minimum = 0.0f;
+    for (float frameTime : frameTimes)
+    {
+        if (frameTime > 0.0f && (minimum == 0.0f || frameTime < minimum))
+        {
+            minimum = frameTime;
+        }
+    }
+    return minimum;
+}
+
+float FramePacer::GetMaxFrameTime()
+{
+    float maximum = 0.0f;
+    for (float frameTime : frameTimes)
+    {
+        maximum = std::max(maximum, frameTime);
+    }
+    return maximum;
+}
+
+float FramePacer::GetPercentileFrameTime(float percentile)
+{
+    // Frames that haven't happened yet are 0 and get left out
+    std::vector<float> sorted;
+    for (float frameTime : frameTimes)
+    {
+        if (frameTime > 0.0f) {sorted.push_back(frameTime);}
+    }
+    if (sorted.empty()) {return 0.0f;}
+
+    std::sort(sorted.begin(), sorted.end());
+    int index = static_cast<int>((percentile / 100.0f) * (sorted.size() - 1) + 0.5f);
+    index = std::clamp(index, 0, static_cast<int>(sorted.size()) - 1);
+    return sorted[index];
+}
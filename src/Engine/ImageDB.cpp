@@ -20,15 +20,53 @@ void ImageDB::LoadImages()
     // Fills up loadedImages if the path exists
     if (std::filesystem::exists(imageDirectoryPath)) 
     {
+        std::vector<std::filesystem::path> imagePaths;
         for (const auto& imageFile : std::filesystem::directory_iterator(imageDirectoryPath))
         {
             if (imageFile.path() != imageDirectoryPath + "/.DS_Store")
             {
-                SDL_Renderer* r = Renderer::renderer;
-                SDL_Texture* img = IMG_LoadTexture(r, imageFile.path().string().c_str());
-                loadedImages[imageFile.path().filename().stem().stem().string()] = img;
+                imagePaths.push_back(imageFile.path());
             }
         }
+        
+        // Headless runs have no renderer to make textures with, but images still need to be found by name
+        if (EngineUtils::headless)
+        {
+            for (const auto& imagePath : imagePaths)
+            {
+                loadedImages[imagePath.filename().stem().stem().string()] = nullptr;
+                imageSizes[imagePath.filename().stem().stem().string()] = {0, 0};
+            }
+            return;
+        }
+        
+        // Decoding the files is the slow part and doesn't touch the renderer, so it's spread across the job system
+        std::vector<SDL_Surface*> surfaces(imagePaths.size(), nullptr);
+        JobSystem::ParallelFor(static_cast<int>(imagePaths.size()), 1, [&imagePaths, &surfaces](int start, int end)
+        {
+            for (int i = start; i < end; i++)
+            {
+                surfaces[i] = IMG_Load(imagePaths[i].string().c_str());
+            }
+        });
+        
+        // Textures have to be made on the thread that owns the renderer
+        for (int i = 0; i < imagePaths.size(); i++)
+        {
+            std::string imageName = imagePaths[i].filename().stem().stem().string();
+            SDL_Texture* img = nullptr;
+            SDL_Point size = {0, 0};
+            
+            if (surfaces[i] != nullptr)
+            {
+                img = SDL_CreateTextureFromSurface(Renderer::renderer, surfaces[i]);
+                size = {surfaces[i]->w, surfaces[i]->h};
+                SDL_FreeSurface(surfaces[i]);
+            }
+            
+            loadedImages[imageName] = img;
+            imageSizes[imageName] = size;
+        }
     }
 }
 
@@ -42,3 +80,27 @@ SDL_Texture* ImageDB::GetImage(std::string imageName)
     }
     return loadedImages[imageName];
 }
+
+// Gets the size of an image in pixels without asking SDL
+void ImageDB::GetImageSize(const std::string& imageName, int& width, int& height)
+{
+    SDL_Texture* texture = nullptr;
+    if (!FindImage(imageName, texture, width, height))
+    {
+        std::cout << "error: missing image " << imageName;
+        exit(0);
+    }
+}
+
+// Looks an image and its size up, returning false instead of exiting if it's missing so it's safe to call from worker threads
+bool ImageDB::FindImage(const std::string& imageName, SDL_Texture*& texture, int& width, int& height)
+{
+    auto image = loadedImages.find(imageName);
+    if (image == loadedImages.end()) {return false;}
+    
+    SDL_Point size = imageSizes.find(imageName)->second;
+    texture = image->second;
+    width = size.x;
+    height = size.y;
+    return true;
+}
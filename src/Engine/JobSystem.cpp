@@ -0,0 +1,204 @@
+//
+//  JobSystem.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/9/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <algorithm>
+#include <cstdlib>
+
+#include "JobSystem.h"
+
+std::vector<std::unique_ptr<JobSystem::WorkQueue>> JobSystem::queues;
+std::vector<std::thread> JobSystem::workers;
+
+thread_local int JobSystem::threadIndex = 0;
+
+std::mutex JobSystem::sleepMutex;
+std::condition_variable JobSystem::wakeWorkers;
+std::atomic<int> JobSystem::queuedJobs{0};
+std::atomic<bool> JobSystem::running{false};
+
+// Starts the worker threads, "worker_threads" in game.config overrides the default of one per extra core
+void JobSystem::Init()
+{
+    if (running) {return;}
+
+    int workerCount = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    if (EngineUtils::game_config.HasMember("worker_threads"))
+    {
+        workerCount = EngineUtils::game_config["worker_threads"].GetInt();
+    }
+    if (workerCount < 0) {workerCount = 0;}
+
+    running = true;
+
+    // The main thread gets a queue too so jobs it queues can be stolen
+    queues.push_back(std::make_unique<WorkQueue>());
+    for (int i = 1; i <= workerCount; i++)
+    {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (int i = 1; i <= workerCount; i++)
+    {
+        workers.emplace_back(WorkerLoop, i);
+    }
+    
+    // Application.Quit calls exit directly, and joinable threads can't be destroyed, so they're joined at exit
+    std::atexit(Shutdown);
+}
+
+// Finishes any queued jobs and joins the worker threads
+void JobSystem::Shutdown()
+{
+    if (!running) {return;}
+
+    // Nothing queued should be lost, run whatever is left before stopping
+    while (RunOneJob()) {}
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        running = false;
+    }
+    wakeWorkers.notify_all();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+    queues.clear();
+}
+
+// Queues a job, the counter (if given) is decremented once it finishes.
+// If dependency is given the job won't start its work until every job counted by it is done.
+void JobSystem::Run(Job job, JobCounter* counter, JobCounter* dependency)
+{
+    if (counter != nullptr)
+    {
+        counter->remaining.fetch_add(1);
+    }
+
+    Job wrapped = [job = std::move(job), counter, dependency]()
+    {
+        if (dependency != nullptr) {Wait(dependency);}
+        job();
+        if (counter != nullptr) {counter->remaining.fetch_sub(1);}
+    };
+
+    // Without a pool (Init not called yet, or 0 workers configured) there is nobody else to run it
+    if (queues.empty())
+    {
+        wrapped();
+        return;
+    }
+
+    WorkQueue& queue = *queues[threadIndex];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(wrapped));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queuedJobs++;
+    }
+    wakeWorkers.notify_one();
+}
+
+// Blocks until every job counted by the counter is done, running queued jobs while it waits
+void JobSystem::Wait(JobCounter* counter)
+{
+    while (counter->remaining.load() > 0)
+    {
+        // Helping out instead of sleeping means nested waits inside jobs can't deadlock the pool
+        if (!RunOneJob())
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Splits [0, count) into batches of batchSize and calls body(start, end) on each of them across the pool.
+// Returns once every batch is done, small ranges just run on the calling thread.
+void JobSystem::ParallelFor(int count, int batchSize, const std::function<void(int, int)>& body)
+{
+    if (count <= 0) {return;}
+    if (batchSize < 1) {batchSize = 1;}
+
+    if (workers.empty() || count <= batchSize)
+    {
+        body(0, count);
+        return;
+    }
+
+    JobCounter counter;
+
+    // The calling thread keeps the first batch for itself
+    for (int start = batchSize; start < count; start += batchSize)
+    {
+        int end = std::min(start + batchSize, count);
+        Run([&body, start, end]() {body(start, end);}, &counter);
+    }
+    body(0, std::min(batchSize, count));
+
+    Wait(&counter);
+}
+
+// Runs one job from this thread's queue or one stolen from another thread, returns false if there wasn't one
+bool JobSystem::RunOneJob()
+{
+    if (queues.empty()) {return false;}
+
+    Job job;
+    int queueCount = static_cast<int>(queues.size());
+
+    // Newest job from our own queue first, it's the most likely to still be in cache
+    {
+        WorkQueue& own = *queues[threadIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty())
+        {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+        }
+    }
+
+    // Otherwise steal the oldest job from someone else
+    for (int offset = 1; !job && offset < queueCount; offset++)
+    {
+        WorkQueue& victim = *queues[(threadIndex + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+        }
+    }
+
+    if (!job) {return false;}
+
+    queuedJobs--;
+    job();
+    return true;
+}
+
+// The loop each worker thread runs until shutdown
+void JobSystem::WorkerLoop(int index)
+{
+    threadIndex = index;
+
+    while (true)
+    {
+        if (RunOneJob()) {continue;}
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeWorkers.wait(lock, []() {return queuedJobs.load() > 0 || !running;});
+
+        if (!running && queuedJobs.load() <= 0) {return;}
+    }
+}
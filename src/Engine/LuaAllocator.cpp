@@ -0,0 +1,214 @@
+//
+//  LuaAllocator.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/21/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+
+#include "LuaAllocator.h"
+
+LuaAllocator::SizeClass LuaAllocator::sizeClasses[LuaAllocator::SIZE_CLASS_COUNT];
+LuaSizeClassStats LuaAllocator::sizeClassStats[LuaAllocator::SIZE_CLASS_COUNT];
+LuaLargeBlockStats LuaAllocator::largeBlockStats;
+int LuaAllocator::classForSize[LuaAllocator::MAX_POOLED_SIZE / LuaAllocator::GRANULARITY + 1];
+bool LuaAllocator::initialized = false;
+
+// The lua_Alloc function to pass to lua_newstate
+void* LuaAllocator::Allocate(void*, void* block, size_t oldSize, size_t newSize)
+{
+    // Lua passes the size of the block whenever it frees or resizes one, so blocks don't need a header to remember it
+    if (newSize == 0)
+    {
+        if (block != nullptr) {Delete(block, oldSize);}
+        return nullptr;
+    }
+    
+    // For new blocks oldSize is the kind of object being made, not a size
+    if (block == nullptr) {return New(newSize);}
+    
+    int oldClass = GetSizeClass(oldSize);
+    int newClass = GetSizeClass(newSize);
+    
+    if (oldClass == -1 && newClass == -1)
+    {
+        void* resized = std::realloc(block, newSize);
+        if (resized == nullptr) {return nullptr;}
+        
+        largeBlockStats.bytesInUse = largeBlockStats.bytesInUse - oldSize + newSize;
+        largeBlockStats.peakBytesInUse = std::max(largeBlockStats.peakBytesInUse, largeBlockStats.bytesInUse);
+        return resized;
+    }
+    
+    // Still fits the block it's in
+    if (oldClass == newClass) {return block;}
+    
+    void* resized = New(newSize);
+    if (resized == nullptr) {return nullptr;}
+    
+    std::memcpy(resized, block, std::min(oldSize, newSize));
+    Delete(block, oldSize);
+    return resized;
+}
+
+// Makes a Lua state that allocates through this allocator and prints an error and exits on an unprotected error like luaL_newstate would
+lua_State* LuaAllocator::NewState()
+{
+    lua_State* state = lua_newstate(Allocate, nullptr);
+    if (state == nullptr)
+    {
+        std::cout << "error: could not create the Lua state";
+        exit(0);
+    }
+    
+    lua_atpanic(state, Panic);
+    return state;
+}
+
+// How much memory is in use in each size class and in large blocks
+const LuaSizeClassStats& LuaAllocator::GetSizeClassStats(int sizeClass)
+{
+    if (!initialized) {InitSizeClasses();}
+    return sizeClassStats[sizeClass];
+}
+
+// The bytes handed to Lua right now, counted by block size, and the bytes taken from the system for them
+size_t LuaAllocator::GetBytesInUse()
+{
+    size_t bytes = largeBlockStats.bytesInUse;
+    for (const LuaSizeClassStats& stats : sizeClassStats)
+    {
+        bytes += stats.GetBytesInUse();
+    }
+    return bytes;
+}
+
+size_t LuaAllocator::GetBytesReserved()
+{
+    size_t bytes = largeBlockStats.bytesInUse;
+    for (const LuaSizeClassStats& stats : sizeClassStats)
+    {
+        bytes += stats.bytesReserved;
+    }
+    return bytes;
+}
+
+// Returns the size class a size falls in, -1 for large blocks
+int LuaAllocator::GetSizeClass(size_t size)
+{
+    if (size > MAX_POOLED_SIZE) {return -1;}
+    return classForSize[(size + GRANULARITY - 1) / GRANULARITY];
+}
+
+// Allocates and frees a block of the given size
+void* LuaAllocator::New(size_t size)
+{
+    if (!initialized) {InitSizeClasses();}
+    
+    int sizeClassIndex = GetSizeClass(size);
+    if (sizeClassIndex == -1)
+    {
+        void* block = std::malloc(size);
+        if (block == nullptr) {return nullptr;}
+        
+        largeBlockStats.blocksInUse++;
+        largeBlockStats.bytesInUse += size;
+        largeBlockStats.peakBytesInUse = std::max(largeBlockStats.peakBytesInUse, largeBlockStats.bytesInUse);
+        largeBlockStats.allocations++;
+        return block;
+    }
+    
+    SizeClass& sizeClass = sizeClasses[sizeClassIndex];
+    LuaSizeClassStats& stats = sizeClassStats[sizeClassIndex];
+    
+    void* block;
+    if (sizeClass.freeList != nullptr)
+    {
+        block = sizeClass.freeList;
+        sizeClass.freeList = sizeClass.freeList->next;
+    }
+    else
+    {
+        if (sizeClass.carveNext == nullptr || sizeClass.carveNext + stats.blockSize > sizeClass.carveEnd)
+        {
+            // Chunks are never given back, the Lua state lives until the program exits
+            char* chunk = static_cast<char*>(std::malloc(CHUNK_SIZE));
+            if (chunk == nullptr) {return nullptr;}
+            
+            sizeClass.carveNext = chunk;
+            sizeClass.carveEnd = chunk + CHUNK_SIZE;
+            stats.bytesReserved += CHUNK_SIZE;
+        }
+        
+        block = sizeClass.carveNext;
+        sizeClass.carveNext += stats.blockSize;
+    }
+    
+    stats.blocksInUse++;
+    stats.peakBlocksInUse = std::max(stats.peakBlocksInUse, stats.blocksInUse);
+    stats.allocations++;
+    return block;
+}
+
+void LuaAllocator::Delete(void* block, size_t size)
+{
+    int sizeClassIndex = GetSizeClass(size);
+    if (sizeClassIndex == -1)
+    {
+        std::free(block);
+        largeBlockStats.blocksInUse--;
+        largeBlockStats.bytesInUse -= size;
+        return;
+    }
+    
+    SizeClass& sizeClass = sizeClasses[sizeClassIndex];
+    FreeBlock* freeBlock = static_cast<FreeBlock*>(block);
+    freeBlock->next = sizeClass.freeList;
+    sizeClass.freeList = freeBlock;
+    
+    sizeClassStats[sizeClassIndex].blocksInUse--;
+}
+
+// Sets up the size classes
+void LuaAllocator::InitSizeClasses()
+{
+    // Close together where Lua's small objects are (strings, closures, table nodes), further apart above that
+    const size_t blockSizes[SIZE_CLASS_COUNT] = {16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512};
+    
+    for (int i = 0; i < SIZE_CLASS_COUNT; i++)
+    {
+        sizeClasses[i] = SizeClass();
+        sizeClassStats[i] = LuaSizeClassStats();
+        sizeClassStats[i].blockSize = blockSizes[i];
+    }
+    
+    // Every size rounded up to GRANULARITY gets the smallest class it fits in, 0 goes in the first class
+    classForSize[0] = 0;
+    int sizeClassIndex = 0;
+    for (size_t step = 1; step < std::size(classForSize); step++)
+    {
+        while (blockSizes[sizeClassIndex] < step * GRANULARITY)
+        {
+            sizeClassIndex++;
+        }
+        classForSize[step] = sizeClassIndex;
+    }
+    initialized = true;
+}
+
+// Called by Lua on errors outside of a protected call
+int LuaAllocator::Panic(lua_State* state)
+{
+    const char* message = lua_tostring(state, -1);
+    std::cout << "error: unprotected error in call to Lua API (" << (message != nullptr ? message : "error object is not a string") << ")";
+    exit(0);
+    return 0;
+}
@@ -0,0 +1,156 @@
+//
+//  LuaGC.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/20/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <string>
+#include <algorithm>
+#include <iostream>
+
+#include "LuaGC.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+
+LuaGCMode LuaGC::mode = LuaGCMode::Incremental;
+double LuaGC::budgetMilliseconds = 1.0;
+int LuaGC::pause = 200;
+
+lua_State* LuaGC::luaState = nullptr;
+bool LuaGC::collecting = false;
+size_t LuaGC::heapAfterCycle = 0;
+
+double LuaGC::lastCollectionMilliseconds = 0.0;
+double LuaGC::maxCollectionMilliseconds = 0.0;
+double LuaGC::totalCollectionMilliseconds = 0.0;
+size_t LuaGC::peakHeapBytes = 0;
+int LuaGC::completedCycles = 0;
+
+// Reads the GC settings and switches the Lua state over to them, has to run after game.config is loaded
+void LuaGC::Init(lua_State* state)
+{
+    luaState = state;
+    
+    if (EngineUtils::game_config.HasMember("lua_gc_mode"))
+    {
+        std::string gcMode = EngineUtils::game_config["lua_gc_mode"].GetString();
+        if (gcMode == "incremental")
+        {
+            mode = LuaGCMode::Incremental;
+        }
+        else if (gcMode == "generational")
+        {
+            mode = LuaGCMode::Generational;
+        }
+        else
+        {
+            std::cout << "error: unknown lua_gc_mode " << gcMode;
+            exit(0);
+        }
+    }
+    if (EngineUtils::game_config.HasMember("lua_gc_budget_ms"))
+    {
+        budgetMilliseconds = std::max(0.0, EngineUtils::game_config["lua_gc_budget_ms"].GetDouble());
+    }
+    if (EngineUtils::game_config.HasMember("lua_gc_pause"))
+    {
+        pause = std::max(100, EngineUtils::game_config["lua_gc_pause"].GetInt());
+    }
+    
+    // Lua's defaults are kept for the step and generation sizes (0 leaves a parameter unchanged)
+    if (mode == LuaGCMode::Generational)
+    {
+        lua_gc(luaState, LUA_GCGEN, 0, 0);
+        lua_gc(luaState, LUA_GCRESTART);
+    }
+    else
+    {
+        // The engine does the collecting at the end of each frame. Lua's own collector is left running with a longer pause,
+        // so a script that makes a lot of garbage within one frame (or a big scene load) can't grow the heap without limit
+        int backstopPause = std::min(pause * BACKSTOP_PAUSE_MULTIPLIER, MAX_LUA_PAUSE);
+        lua_gc(luaState, LUA_GCINC, backstopPause, 0, 0);
+        lua_gc(luaState, LUA_GCRESTART);
+    }
+    
+    collecting = false;
+    heapAfterCycle = GetHeapBytes();
+    peakHeapBytes = heapAfterCycle;
+}
+
+// Does this frame's collection work, called once the frame is done and before it's presented
+void LuaGC::Step()
+{
+    if (luaState == nullptr) {return;}
+    
+    PROFILE_SCOPE("LuaGC::Step");
+    Uint64 start = SDL_GetPerformanceCounter();
+    
+    // Time the pacer would spend waiting is free to use
+    double budgetSeconds = std::max(budgetMilliseconds / 1000.0, FramePacer::GetIdleSeconds());
+    
+    if (mode == LuaGCMode::Generational)
+    {
+        // A young collection only looks at what was allocated since the last one, so it stays short
+        if (budgetSeconds > 0.0)
+        {
+            lua_gc(luaState, LUA_GCSTEP, 0);
+        }
+    }
+    else
+    {
+        StepIncremental(start, budgetSeconds);
+    }
+    
+    lastCollectionMilliseconds = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+    maxCollectionMilliseconds = std::max(maxCollectionMilliseconds, lastCollectionMilliseconds);
+    totalCollectionMilliseconds += lastCollectionMilliseconds;
+    
+    size_t heapBytes = GetHeapBytes();
+    peakHeapBytes = std::max(peakHeapBytes, heapBytes);
+    
+    Profiler::RecordCounter("Lua heap (KB)", static_cast<double>(heapBytes) / 1024.0);
+    Profiler::RecordCounter("Lua GC (ms)", lastCollectionMilliseconds);
+}
+
+// Runs incremental steps until the cycle finishes or the time runs out
+void LuaGC::StepIncremental(Uint64 start, double budgetSeconds)
+{
+    size_t heapBytes = GetHeapBytes();
+    size_t threshold = heapAfterCycle / 100 * static_cast<size_t>(pause);
+    
+    // Like Lua's own pause, nothing is collected until the heap has grown enough to be worth it
+    if (!collecting)
+    {
+        if (heapBytes < threshold) {return;}
+        collecting = true;
+    }
+    
+    // Scripts are allocating faster than the budget collects, so the cycle is finished now before the heap runs away
+    bool overBudget = heapBytes >= threshold * 2;
+    
+    Uint64 budgetTicks = static_cast<Uint64>(budgetSeconds * static_cast<double>(SDL_GetPerformanceFrequency()));
+    while (true)
+    {
+        // Returns 1 once the step finishes the cycle
+        if (lua_gc(luaState, LUA_GCSTEP, 0) != 0)
+        {
+            collecting = false;
+            heapAfterCycle = GetHeapBytes();
+            completedCycles++;
+            return;
+        }
+        
+        if (!overBudget && SDL_GetPerformanceCounter() - start >= budgetTicks) {return;}
+    }
+}
+
+// The number of bytes Lua has allocated right now
+size_t LuaGC::GetHeapBytes()
+{
+    if (luaState == nullptr) {return 0;}
+    return static_cast<size_t>(lua_gc(luaState, LUA_GCCOUNT)) * 1024 + static_cast<size_t>(lua_gc(luaState, LUA_GCCOUNTB));
+}
@@ -0,0 +1,177 @@
+//
+//  NativeComponentDB.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/18/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <iostream>
+#include <algorithm>
+
+#include "NativeComponentDB.h"
+#include "Actor.h"
+
+// NativeComponentType Struct
+// Sets the declared fields named in a component's JSON, anything else in it is ignored
+void NativeComponentType::LoadProperties(const luabridge::LuaRef& component, const rapidjson::Value& properties) const
+{
+    NativeComponent* base = getBase(component);
+    for (rapidjson::Value::ConstMemberIterator itr = properties.MemberBegin(); itr != properties.MemberEnd(); itr++)
+    {
+        auto loader = loaders.find(itr->name.GetString());
+        if (loader != loaders.end())
+        {
+            loader->second(base, itr->value);
+        }
+    }
+}
+
+// NativeComponentDB Class
+// Adds a declared type, declaring the same name twice is an error
+void NativeComponentDB::AddType(const NativeComponentType& type)
+{
+    auto& types = GetTypes();
+    if (types.find(type.name) != types.end())
+    {
+        std::cout << "error: native component type " << type.name << " declared twice";
+        exit(0);
+    }
+    
+    types[type.name] = std::make_unique<NativeComponentType>(type);
+    const NativeComponentType* newType = types[type.name].get();
+    
+    if (newType->batchUpdate != nullptr)
+    {
+        batchUpdatedTypes.push_back(newType);
+    }
+}
+
+// Returns the C++ component type with the given name, or nullptr if it is a Lua type
+const NativeComponentType* NativeComponentDB::FindType(const std::string& name)
+{
+    auto& types = GetTypes();
+    auto type = types.find(name);
+    return type != types.end() ? type->second.get() : nullptr;
+}
+
+// Runs the batch update of every type that has one, in the order they were declared. Only used when updates are grouped by type
+void NativeComponentDB::BatchUpdate()
+{
+    for (const NativeComponentType* type : batchUpdatedTypes)
+    {
+        type->batchUpdate();
+    }
+}
+
+// Returns true if the component should have its lifecycle functions called
+bool NativeComponentDB::IsActive(const NativeComponent& component)
+{
+    return component.enabled && component.started && component.actor != nullptr && component.actor->enabled;
+}
+
+// Returns true if the scene would update a before b, by actor ID and then initOrder
+bool NativeComponentDB::UpdatesBefore(const NativeComponent* a, const NativeComponent* b)
+{
+    if (a->actor->ID != b->actor->ID) {return a->actor->ID < b->actor->ID;}
+    return a->initOrder < b->initOrder;
+}
+
+// Makes sure every thread in the job system has a command buffer, call before a parallel update starts
+void NativeComponentDB::PrepareCommandBuffers()
+{
+    size_t threadCount = static_cast<size_t>(JobSystem::GetWorkerCount()) + 1;
+    if (commandBuffers.size() < threadCount)
+    {
+        commandBuffers.resize(threadCount);
+    }
+}
+
+// Applies every recorded command on the main thread and empties the buffers.
+// Commands are applied in the order of the components that recorded them, so how the work was split between threads doesn't matter.
+void NativeComponentDB::ApplyCommands()
+{
+    mergedCommands.clear();
+    for (NativeCommandBuffer& buffer : commandBuffers)
+    {
+        mergedCommands.insert(mergedCommands.end(), buffer.commands.begin(), buffer.commands.end());
+        buffer.commands.clear();
+    }
+    
+    // A component's commands are all recorded on one thread in the order it made them, a stable sort keeps that order
+    std::stable_sort(mergedCommands.begin(), mergedCommands.end(), [](const NativeCommand& a, const NativeCommand& b) {return a.order < b.order;});
+    
+    for (NativeCommand& command : mergedCommands)
+    {
+        command.apply(command);
+    }
+    mergedCommands.clear();
+}
+
+// Reads a JSON value into a field, does nothing and returns false if the value is the wrong kind
+bool NativeComponentDB::ReadJson(const rapidjson::Value& value, float& field)
+{
+    if (!value.IsNumber()) {return false;}
+    field = value.GetFloat();
+    return true;
+}
+
+bool NativeComponentDB::ReadJson(const rapidjson::Value& value, int& field)
+{
+    if (!value.IsNumber()) {return false;}
+    
+    // Truncates the value like Lua did when it was set through the component's table
+    field = static_cast<int>(value.GetDouble());
+    return true;
+}
+
+bool NativeComponentDB::ReadJson(const rapidjson::Value& value, bool& field)
+{
+    if (!value.IsBool()) {return false;}
+    field = value.GetBool();
+    return true;
+}
+
+bool NativeComponentDB::ReadJson(const rapidjson::Value& value, std::string& field)
+{
+    if (!value.IsString()) {return false;}
+    field = value.GetString();
+    return true;
+}
+
+bool NativeComponentDB::ReadJson(const rapidjson::Value& value, std::vector<float>& field)
+{
+    if (!value.IsArray()) {return false;}
+    
+    field.clear();
+    for (rapidjson::SizeType i = 0; i < value.Size(); i++)
+    {
+        if (value[i].IsNumber())
+        {
+            field.push_back(value[i].GetFloat());
+        }
+    }
+    return true;
+}
+
+bool NativeComponentDB::ReadJson(const rapidjson::Value& value, std::vector<std::vector<float>>& field)
+{
+    if (!value.IsArray()) {return false;}
+    
+    field.clear();
+    for (rapidjson::SizeType i = 0; i < value.Size(); i++)
+    {
+        field.push_back({});
+        ReadJson(value[i], field.back());
+    }
+    return true;
+}
+
+// Never freed, records of template components are still being destroyed when the program exits
+std::unordered_map<std::string, std::unique_ptr<NativeComponentType>>& NativeComponentDB::GetTypes()
+{
+    static auto* types = new std::unordered_map<std::string, std::unique_ptr<NativeComponentType>>();
+    return *types;
+}
@@ -10,12 +10,14 @@
 #include <stdio.h>
 
 #include "ParticleSystem.h"
+#include "TimeHandler.h"
 
 // Particle System functions
 void ParticleSystem::StartEmitting()
 {
     emitting = true;
-    framesActive = 0.0f;
+    timeActive = 0.0f;
+    emissionTimer = 0.0f;
 }
 
 void ParticleSystem::StopEmitting()
@@ -58,17 +60,18 @@ void ParticleSystem::CreateParticle()
     b2Vec2 velocity = b2Vec2(cos(direction) * speed, sin(direction) * speed);
     newParticle->body->SetLinearVelocity(velocity);
     
-    particles.push(newParticle);
+    particles.push_back(newParticle);
 }
 
+// Works out a particle's new color, size and velocity, only touches the particle itself so it's safe to run on a worker thread
 void ParticleSystem::UpdateParticle(Particle* particle)
 {
-    // Update particles according to a pattern (also update particle's hitbox size to match if size changes)
+    // Update particles according to a pattern (the hitbox and body are updated to match in ApplyParticleToBody)
     
     // Update color
     if (change_color)
     {
-        // The change in color per frame
+        // The change in color this frame
         std::vector<float> delta_color = GetDeltaColor(particle);
         
         particle->color[0] += delta_color[0];
@@ -98,7 +101,7 @@ void ParticleSystem::UpdateParticle(Particle* particle)
         {
             case 'l':
                 // Linear pattern
-                delta_size = size_change_per_second / 60;
+                delta_size = size_change_per_second * TimeHandler::deltaTime;
                 particle->size += delta_size;
                 break;
                 
@@ -123,13 +126,6 @@ void ParticleSystem::UpdateParticle(Particle* particle)
         {
             particle->size = -0.001f;
         }
-        
-        // Update hitbox to match the new size
-        if (has_collider)
-        {
-            particle->body->DestroyFixture(particle->body->GetFixtureList());
-            particle->body->CreateFixture(GetNewCollider(particle->size));
-        }
     }
     
     // Update movement
@@ -160,7 +156,23 @@ void ParticleSystem::UpdateParticle(Particle* particle)
                 break;
         }
         
-        particle->body->SetLinearVelocity(newVelocity);
+        particle->velocity = newVelocity;
+    }
+}
+
+// Pushes the results of UpdateParticle into box2d, which isn't thread safe so this runs on the main thread
+void ParticleSystem::ApplyParticleToBody(Particle* particle)
+{
+    // Update hitbox to match the new size
+    if (change_size && has_collider)
+    {
+        particle->body->DestroyFixture(particle->body->GetFixtureList());
+        particle->body->CreateFixture(GetNewCollider(particle->size));
+    }
+    
+    if (change_movement)
+    {
+        particle->body->SetLinearVelocity(particle->velocity);
     }
 }
 
@@ -197,7 +209,7 @@ std::vector<float> ParticleSystem::GetDeltaColor(Particle* particle)
     std::vector<float> delta_color;
     for (int i = 0; i < 4; i++)
     {
-        delta_color.push_back((colors[particle->future_color_index][i] - colors[particle->former_color_index][i]) / (60 * transition_time));
+        delta_color.push_back(((colors[particle->future_color_index][i] - colors[particle->former_color_index][i]) / transition_time) * TimeHandler::deltaTime);
     }
     return delta_color;
 }
@@ -236,20 +248,41 @@ void ParticleSystem::DestroyParticle(Particle* particle)
     delete particle;
 }
 
-void ParticleSystem::RenderParticle(Particle* particle)
+void ParticleSystem::RenderParticle(Particle* particle, b2Vec2 position, float rotation)
 {
-    b2Vec2 position = particle->body->GetPosition();
-    float rotation = particle->body->GetAngle() * (180 / b2_pi);
-    
     // Ensures particles have a constanst size, not dependant on their sprite size
-    int particleWidth = 0;
-    int particleHeight = 0;
-    SDL_QueryTexture(ImageDB::GetImage(image), NULL, NULL, &particleWidth, &particleHeight);
-    float particleScale = particle->size / (particleWidth / Renderer::PIXELS_PER_UNIT);
+    float particleScale = particle->size / imageWidthInUnits;
     
     Renderer::DrawEx(image, position.x, position.y, rotation, particleScale, particleScale, 0.5f, 0.5f, particle->color[0], particle->color[1], particle->color[2], particle->color[3], sorting_order);
 }
 
+// Makes new particles and takes them through the same update the others had this frame
+void ParticleSystem::EmitParticles(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        CreateParticle();
+        Particle* particle = particles.back();
+        
+        UpdateParticle(particle);
+        particle->age += TimeHandler::deltaTime;
+        
+        if (particle->age < particle_lifetime && particle->size >= 0.0f)
+        {
+            ApplyParticleToBody(particle);
+            
+            b2Vec2 position = PhysicsHandler::GetInterpolatedPosition(particle->body);
+            float rotation = PhysicsHandler::GetInterpolatedAngle(particle->body) * (180 / b2_pi);
+            RenderParticle(particle, position, rotation);
+        }
+        else
+        {
+            DestroyParticle(particle);
+            particles.pop_back();
+        }
+    }
+}
+
 // Standard lifecycle functions
 void ParticleSystem::OnStart()
 {
@@ -345,85 +378,142 @@ void ParticleSystem::OnStart()
 }
 
 void ParticleSystem::OnUpdate()
+{
+    // The same update the job system runs, with its commands applied straight after
+    NativeCommandBuffer buffer;
+    UpdateParallel(buffer);
+    
+    for (NativeCommand& command : buffer.commands)
+    {
+        command.apply(command);
+    }
+}
+
+// OnUpdate without anything that touches Box2D, the renderer or random numbers, those are recorded into buffer.
+// Only changes this system, so every system can be updated at once on the job system
+void ParticleSystem::UpdateParallel(NativeCommandBuffer& buffer)
 {
     /* Emission Phase */
-    if (emitting && num_particles < MAX_NUM_PARTICLES)
+    // Works out how many particles the time since the last frame is worth, so the emission rate doesn't depend on the frame rate.
+    // They are made when the commands are applied since making them needs Box2D and random numbers
+    int particlesToEmit = 0;
+    if (emitting && num_particles < MAX_NUM_PARTICLES && emission_rate > 0)
     {
-        // Emission rate is impercise with larger rates,
-        // But the larger rates should result in a more accurate aproximation
-        if (emission_rate > 60)
+        float secondsPerParticle = 1.0f / emission_rate;
+        emissionTimer += TimeHandler::deltaTime;
+        
+        // The very first frame of emission always emits
+        if (timeActive == 0.0f && emissionTimer < secondsPerParticle)
         {
-            int num_particles_to_spawn = std::ceil(Application::RandomNumber(0, (emission_rate / 60.0f) * 2u, 100));
-            //std::cout << num_particles_to_spawn << std::endl;
-            if (num_particles + num_particles_to_spawn < MAX_NUM_PARTICLES)
-            {
-                for (int i = 0; i < num_particles_to_spawn; i++)
-                {
-                    CreateParticle();
-                }
-            }
+            emissionTimer = secondsPerParticle;
         }
-        // Emission rate is exact when less than 60, this is because each second is exactly 60 frames long.
-        else if (framesActive % (60 / emission_rate) == 0)
+        
+        while (emissionTimer >= secondsPerParticle && num_particles + particlesToEmit < MAX_NUM_PARTICLES)
         {
-            CreateParticle();
+            emissionTimer -= secondsPerParticle;
+            particlesToEmit++;
         }
     }
-    if (num_particles == 0) {return;}
+    if (num_particles + particlesToEmit == 0) {return;}
     
-    std::queue<Particle*> renderingQueue;
+    // Every particle is drawn at the same size regardless of its sprite, so the sprite is only measured once
+    buffer.Record(ApplyMeasureImage, this);
     
     /* Simulation Phase */
-    // Physics done automatically by box2d
-    while (!particles.empty())
+    // Physics done automatically by box2d, the per particle pattern math is spread across the job system
+    JobSystem::ParallelFor(static_cast<int>(particles.size()), 256, [this](int start, int end)
+    {
+        for (int i = start; i < end; i++)
+        {
+            UpdateParticle(particles[i]);
+            
+            // Ages the particle by the length of this frame
+            particles[i]->age += TimeHandler::deltaTime;
+        }
+    });
+    
+    /* Rendering Phase */
+    // Removes particles whose lifetime is up and draws the rest, keeping them in the order they were emitted
+    bool changesBody = (change_size && has_collider) || change_movement;
+    int particlesKept = 0;
+    for (Particle* particle : particles)
     {
-        Particle* particle = particles.front();
-        particles.pop();
-        
-        UpdateParticle(particle);
-        
-        // Ages the particle by 1 frame
-        particle->age += (1.0f / 60.0f);
-        
-        // Removes a particle from the queue if it's lifetime is up
         if (particle->age < particle_lifetime && particle->size >= 0.0f)
         {
-            renderingQueue.push(particle);
+            if (changesBody)
+            {
+                buffer.Record(ApplyParticleBody, this, particle);
+            }
+            particles[particlesKept] = particle;
+            particlesKept++;
+            
+            // Reading bodies is safe while nothing is writing to them
+            b2Vec2 position = PhysicsHandler::GetInterpolatedPosition(particle->body);
+            float rotation = PhysicsHandler::GetInterpolatedAngle(particle->body) * (180 / b2_pi);
+            buffer.Record(ApplyRenderParticle, this, particle, position.x, position.y, rotation);
         }
         else
         {
-            DestroyParticle(particle);
+            buffer.Record(ApplyDestroyParticle, this, particle);
         }
     }
+    particles.resize(particlesKept);
     
-    /* Rendering Phase */
-    while (!renderingQueue.empty())
+    // New particles come after the rest, like they would have if they were made first
+    if (particlesToEmit > 0)
     {
-        Particle* particle = renderingQueue.front();
-        renderingQueue.pop();
-        particles.push(particle);
-        
-        RenderParticle(particle);
+        buffer.Record(ApplyEmitParticles, this, nullptr, static_cast<float>(particlesToEmit));
     }
     
     // If this particle system has been emitting for longer than its duration then stop emitting.
-    if (!loop && framesActive / 60.0f > duration)
+    if (!loop && timeActive > duration)
     {
         emitting = false;
     }
     else
     {
-        framesActive++;
+        timeActive += TimeHandler::deltaTime;
     }
 }
 
 void ParticleSystem::OnDestroy()
 {
     if (num_particles == 0) {return;}
-    for (int i = 0; i < num_particles; i++)
+    for (Particle* particle : particles)
     {
-        Particle* particle = particles.front();
-        particles.pop();
         DestroyParticle(particle);
     }
+    particles.clear();
+}
+
+// Commands recorded by UpdateParallel, applied on the main thread
+void ParticleSystem::ApplyMeasureImage(NativeCommand& command)
+{
+    ParticleSystem* system = static_cast<ParticleSystem*>(command.component);
+    
+    int imageWidth = 0;
+    int imageHeight = 0;
+    ImageDB::GetImageSize(system->image, imageWidth, imageHeight);
+    system->imageWidthInUnits = imageWidth / Renderer::PIXELS_PER_UNIT;
+}
+
+void ParticleSystem::ApplyParticleBody(NativeCommand& command)
+{
+    static_cast<ParticleSystem*>(command.component)->ApplyParticleToBody(static_cast<Particle*>(command.target));
+}
+
+void ParticleSystem::ApplyRenderParticle(NativeCommand& command)
+{
+    b2Vec2 position(command.values[0], command.values[1]);
+    static_cast<ParticleSystem*>(command.component)->RenderParticle(static_cast<Particle*>(command.target), position, command.values[2]);
+}
+
+void ParticleSystem::ApplyDestroyParticle(NativeCommand& command)
+{
+    static_cast<ParticleSystem*>(command.component)->DestroyParticle(static_cast<Particle*>(command.target));
+}
+
+void ParticleSystem::ApplyEmitParticles(NativeCommand& command)
+{
+    static_cast<ParticleSystem*>(command.component)->EmitParticles(static_cast<int>(command.values[0]));
 }
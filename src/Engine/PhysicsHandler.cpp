@@ -12,6 +12,10 @@
 
 #include "PhysicsHandler.h"
 #include "Actor.h"
+#include "SceneDB.h"
+#include "Transform.h"
+#include "TimeHandler.h"
+#include "Profiler.h"
 
 // ContactListener Class
 // Called whenever 2 collisions come into contact
@@ -22,39 +26,32 @@ void ContactListener::BeginContact(b2Contact* contact)
 
     if (ActorA == nullptr || ActorB == nullptr) { return; }
     
-    Collision col;
-    col.relative_velocity = contact->GetFixtureA()->GetBody()->GetLinearVelocity() - contact->GetFixtureB()->GetBody()->GetLinearVelocity();
+    ContactEvent event;
+    event.actorA = ActorA;
+    event.actorB = ActorB;
+    event.handleA = ActorA->handle;
+    event.handleB = ActorB->handle;
+    event.relativeVelocity = contact->GetFixtureA()->GetBody()->GetLinearVelocity() - contact->GetFixtureB()->GetBody()->GetLinearVelocity();
 
     // Trigger contact
     if (contact->GetFixtureA()->IsSensor())
     {
-        col.point = b2Vec2(-999.0f, -999.0f);
-        col.normal = b2Vec2(-999.0f, -999.0f);
-
-        // Calls for fixture A
-        col.other = ActorB;
-        ActorA->TriggerEnter(col);
-
-        // Calls for fixture B
-        col.other = ActorA;
-        ActorB->TriggerEnter(col);
+        event.function = ON_TRIGGER_ENTER;
+        event.point = b2Vec2(-999.0f, -999.0f);
+        event.normal = b2Vec2(-999.0f, -999.0f);
     }
     // Collider contact
     else
     {
         b2WorldManifold worldManifold;
         contact->GetWorldManifold(&worldManifold);
-        col.point = worldManifold.points[0];
-        col.normal = worldManifold.normal;
-
-        // Calls for fixture A
-        col.other = ActorB;
-        ActorA->CollisionEnter(col);
-
-        // Calls for fixture B
-        col.other = ActorA;
-        ActorB->CollisionEnter(col);
+        
+        event.function = ON_COLLISION_ENTER;
+        event.point = worldManifold.points[0];
+        event.normal = worldManifold.normal;
     }
+    
+    PhysicsHandler::contactEvents.push_back(event);
 }
 
 // Called whenever 2 collisions stop touching
@@ -65,33 +62,17 @@ void ContactListener::EndContact(b2Contact* contact)
 
     if (ActorA == nullptr || ActorB == nullptr) { return; }
 
-    Collision col;
-    col.relative_velocity = contact->GetFixtureA()->GetBody()->GetLinearVelocity() - contact->GetFixtureB()->GetBody()->GetLinearVelocity();
-    col.point = b2Vec2(-999.0f, -999.0f);
-    col.normal = b2Vec2(-999.0f, -999.0f);
-
-    // Trigger contact
-    if (contact->GetFixtureA()->IsSensor())
-    {
-        // Calls for fixture A
-        col.other = ActorB;
-        ActorA->TriggerExit(col);
-
-        // Calls for fixture B
-        col.other = ActorA;
-        ActorB->TriggerExit(col);
-    }
-    // Collider contact
-    else
-    {
-        // Calls for fixture A
-        col.other = ActorB;
-        ActorA->CollisionExit(col);
-
-        // Calls for fixture B
-        col.other = ActorA;
-        ActorB->CollisionExit(col);
-    }
+    ContactEvent event;
+    event.function = contact->GetFixtureA()->IsSensor() ? ON_TRIGGER_EXIT : ON_COLLISION_EXIT;
+    event.actorA = ActorA;
+    event.actorB = ActorB;
+    event.handleA = ActorA->handle;
+    event.handleB = ActorB->handle;
+    event.relativeVelocity = contact->GetFixtureA()->GetBody()->GetLinearVelocity() - contact->GetFixtureB()->GetBody()->GetLinearVelocity();
+    event.point = b2Vec2(-999.0f, -999.0f);
+    event.normal = b2Vec2(-999.0f, -999.0f);
+    
+    PhysicsHandler::contactEvents.push_back(event);
 }
 
 // Raycast Callback Class
@@ -103,7 +84,7 @@ float RayCastCallback::ReportFixture(b2Fixture* fixture, const b2Vec2& point, co
     
     HitResult* result = new HitResult;
     result->point = point;
-    result->actor = actor;
+    result->actor = ActorRef(actor);
     result->normal = normal;
     result->is_trigger = fixture->IsSensor();
     
@@ -184,13 +165,82 @@ void PhysicsHandler::Init()
     world->SetContactListener(new ContactListener());
 }
 
-// Steps forwards in the physics engine by one frame
-void PhysicsHandler::Step()
+// Steps forwards in the physics engine by one fixed tick
+void PhysicsHandler::Step(float timeStep)
 {
+    PROFILE_SCOPE("PhysicsHandler::Step");
+    
     // Don't advance the physics world if it hasn't been initialized
     if (!phyicsActive) {return;}
     
-    world->Step(1.0f / 60.0f, 8, 3);
+    // Remembers where everything was so drawing can blend towards the new positions
+    previousTransforms.clear();
+    for (b2Body* body = world->GetBodyList(); body != nullptr; body = body->GetNext())
+    {
+        previousTransforms[body] = {body->GetPosition(), body->GetAngle()};
+    }
+    
+    world->Step(timeStep, 8, 3);
+    
+    // Contacts are called once the world is unlocked so Lua can change bodies in them
+    DispatchContacts();
+}
+
+// Calls the contact functions for every contact found since the last dispatch
+void PhysicsHandler::DispatchContacts()
+{
+    if (contactEvents.empty()) {return;}
+    
+    PROFILE_SCOPE("PhysicsHandler::DispatchContacts");
+    
+    // Contacts caused by the calls (like a removed body ending its contacts) are added to the end and called too
+    for (size_t i = 0; i < contactEvents.size(); i++)
+    {
+        ContactEvent event = contactEvents[i];
+        
+        // Actors that left the scene since the contact was found don't get called
+        Actor* actorA = SceneDB::currentScene.actors.Get(event.handleA);
+        Actor* actorB = SceneDB::currentScene.actors.Get(event.handleB);
+        if (actorA != event.actorA || actorB != event.actorB) {continue;}
+        
+        Collision col;
+        col.point = event.point;
+        col.normal = event.normal;
+        col.relative_velocity = event.relativeVelocity;
+        
+        // Calls for fixture A
+        col.other = ActorRef(actorB);
+        actorA->CallContactFunction(event.function, col);
+        
+        // Calls for fixture B
+        col.other = ActorRef(actorA);
+        actorB->CallContactFunction(event.function, col);
+    }
+    
+    contactEvents.clear();
+}
+
+// Gets a bodies position blended between the previous and current tick by the TimeHandler's alpha
+b2Vec2 PhysicsHandler::GetInterpolatedPosition(b2Body* body)
+{
+    auto previous = previousTransforms.find(body);
+    
+    // Bodies created since the last step have nowhere to blend from
+    if (previous == previousTransforms.end()) {return body->GetPosition();}
+    
+    float alpha = TimeHandler::alpha;
+    return (1.0f - alpha) * previous->second.position + alpha * body->GetPosition();
+}
+
+// Gets a bodies angle blended between the previous and current tick by the TimeHandler's alpha
+float PhysicsHandler::GetInterpolatedAngle(b2Body* body)
+{
+    auto previous = previousTransforms.find(body);
+    
+    if (previous == previousTransforms.end()) {return body->GetAngle();}
+    
+    float alpha = TimeHandler::alpha;
+    return (1.0f - alpha) * previous->second.angle + alpha * body->GetAngle();
 }
 
 // Rigidbody:
@@ -254,6 +304,20 @@ float Rigidbody::GetRotation()
     return body->GetAngle() * (180 / b2_pi);
 }
 
+b2Vec2 Rigidbody::GetInterpolatedPosition()
+{
+    if (body == nullptr) {return b2Vec2(x, y);}
+    
+    return PhysicsHandler::GetInterpolatedPosition(body);
+}
+
+float Rigidbody::GetInterpolatedRotation()
+{
+    if (body == nullptr) {return rotation;}
+    
+    return PhysicsHandler::GetInterpolatedAngle(body) * (180 / b2_pi);
+}
+
 b2Vec2 Rigidbody::GetVelocity() {return body->GetLinearVelocity();}
 float Rigidbody::GetAngularVelocity() {return body->GetAngularVelocity() * (180 / b2_pi);}
 float Rigidbody::GetGravityScale() 
@@ -271,6 +335,20 @@ void Rigidbody::OnStart()
 {
     PhysicsHandler::Init();
     
+    // A Transform on the same actor decides where the body starts, bodies are in world space so a parented one starts where it is drawn
+    if (actor != nullptr)
+    {
+        luabridge::LuaRef transformComponent = actor->GetComponent("Transform");
+        if (!transformComponent.isNil())
+        {
+            transform = transformComponent.cast<Transform*>();
+            b2Vec2 position = transform->GetWorldPosition();
+            x = position.x;
+            y = position.y;
+            rotation = transform->GetWorldRotation();
+        }
+    }
+    
     b2BodyDef bodyDef;
     
     // Sets the body type
@@ -302,7 +380,15 @@ void Rigidbody::OnStart()
     bodyDef.position.y = y;
     bodyDef.angle = rotation * (b2_pi / 180);
     
+    // Lets the Transform the body is attached to find this component
+    bodyDef.userData.pointer = reinterpret_cast<uintptr_t>(this);
+    
     body = PhysicsHandler::world->CreateBody(&bodyDef);
+    
+    if (transform != nullptr)
+    {
+        transform->AttachBody(body);
+    }
    
     // Gives the body a shape in the world
     /* phantom sensor to make bodies move if neither collider nor trigger is present */
@@ -389,5 +475,14 @@ void Rigidbody::OnStart()
 // Called this component is removed from its actor
 void Rigidbody::OnDestroy()
 {
+    if (transform != nullptr)
+    {
+        transform->DetachBody();
+        transform = nullptr;
+    }
+    
     PhysicsHandler::world->DestroyBody(body);
+    
+    // Destroying a body ends its contacts immediately, so they are called before the component is gone
+    PhysicsHandler::DispatchContacts();
 }
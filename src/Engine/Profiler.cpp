@@ -0,0 +1,153 @@
+//
+//  Profiler.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/6/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <fstream>
+#include <cstdlib>
+#include <iostream>
+
+#include "Profiler.h"
+
+bool Profiler::enabled = false;
+std::string Profiler::tracePath = "profile_trace.json";
+
+ProfileEvent Profiler::events[Profiler::BUFFER_SIZE];
+std::atomic<uint64_t> Profiler::writeIndex{0};
+
+// Reads the profiler settings and registers the trace to be written at exit
+void Profiler::Init()
+{
+    if (EngineUtils::game_config.HasMember("profiler"))
+    {
+        enabled = EngineUtils::game_config["profiler"].GetBool();
+    }
+    if (std::getenv("PROFILER") != nullptr)
+    {
+        enabled = true;
+    }
+
+    if (EngineUtils::game_config.HasMember("profiler_trace_path"))
+    {
+        tracePath = EngineUtils::game_config["profiler_trace_path"].GetString();
+    }
+
+    // Application.Quit calls exit directly, so the trace can't be written at the end of Engine::Game
+    if (enabled)
+    {
+        std::atexit(WriteTraceAtExit);
+    }
+}
+
+// Adds a finished section to the ring buffer, safe to call from any thread
+void Profiler::Record(const char* name, Uint64 start, Uint64 end)
+{
+    uint64_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    ProfileEvent& event = events[index & (BUFFER_SIZE - 1)];
+
+    // Odd sequence numbers mean the slot is being written, the fence keeps the fields from being written before it
+    event.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.threadID = GetThreadID();
+    event.counter = false;
+    event.sequence.store(index * 2 + 2, std::memory_order_release);
+}
+
+// Adds the value a counter had at this moment, shown as a graph in the trace
+void Profiler::RecordCounter(const char* name, double value)
+{
+    if (!enabled) {return;}
+
+    uint64_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    ProfileEvent& event = events[index & (BUFFER_SIZE - 1)];
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    event.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name = name;
+    event.start = now;
+    event.end = now;
+    event.threadID = GetThreadID();
+    event.counter = true;
+    event.value = value;
+    event.sequence.store(index * 2 + 2, std::memory_order_release);
+}
+
+// Writes every event still in the ring buffer to a Chrome trace_event JSON file
+void Profiler::WriteTrace(std::string path)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cout << "\033[31m" << "Profiler : could not open " << path << "\033[0m" << std::endl;
+        return;
+    }
+
+    uint64_t endIndex = writeIndex.load(std::memory_order_acquire);
+    uint64_t startIndex = endIndex > BUFFER_SIZE ? endIndex - BUFFER_SIZE : 0;
+    double microsecondsPerTick = 1000000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    for (uint64_t index = startIndex; index < endIndex; index++)
+    {
+        ProfileEvent& event = events[index & (BUFFER_SIZE - 1)];
+
+        // Skips slots that are still being written or have already been overwritten by a newer event
+        if (event.sequence.load(std::memory_order_acquire) != index * 2 + 2)
+        {
+            continue;
+        }
+
+        // The fields are copied out and only used if no Record started writing the slot while they were read
+        const char* name = event.name;
+        Uint64 start = event.start;
+        Uint64 end = event.end;
+        int threadID = event.threadID;
+        bool counter = event.counter;
+        double value = event.value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.sequence.load(std::memory_order_relaxed) != index * 2 + 2)
+        {
+            continue;
+        }
+
+        if (!first) {file << ",";}
+        first = false;
+
+        if (counter)
+        {
+            file << "\n{\"name\":\"" << name << "\",\"ph\":\"C\",\"pid\":1"
+                 << ",\"ts\":" << static_cast<double>(start) * microsecondsPerTick
+                 << ",\"args\":{\"value\":" << value << "}}";
+            continue;
+        }
+
+        file << "\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadID
+             << ",\"ts\":" << static_cast<double>(start) * microsecondsPerTick
+             << ",\"dur\":" << static_cast<double>(end - start) * microsecondsPerTick << "}";
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+// Gives every thread that records an event a small ID for the trace
+int Profiler::GetThreadID()
+{
+    static std::atomic<int> nextThreadID{1};
+    thread_local int threadID = nextThreadID.fetch_add(1);
+    return threadID;
+}
+
+// Called by atexit so traces get written no matter how the game quits
+void Profiler::WriteTraceAtExit()
+{
+    WriteTrace(tracePath);
+}
@@ -8,10 +8,12 @@
 //  School Email: mrjacob@umich.edu
 
 #include <stdio.h>
+#include <algorithm>
 
 #include "Renderer.h"
 #include "TextDB.h"
 #include "SceneDB.h"
+#include "FramePacer.h"
 
 SDL_Window* Renderer::window;
 SDL_Renderer* Renderer::renderer;
@@ -31,9 +33,16 @@ int Renderer::clear_b = 255;
 
 bool Renderer::show_gizmos = false;
 
+long long Renderer::drawCallsSubmitted = 0;
+
+bool Renderer::pipelined = false;
+
 // Initializes the window and renderer
 void Renderer::RenderStart()
 {
+    // Headless runs draw into nothing, so there is no window or renderer to make
+    if (EngineUtils::headless) {return;}
+    
     std::string gameTitle = "";
     
     if (EngineUtils::game_config.HasMember("game_title"))
@@ -42,12 +51,18 @@ void Renderer::RenderStart()
     }
     
     window = Helper::SDL_CreateWindow498(gameTitle.c_str(), 0, 0, windowWidth, windowHeight, 0);
-    renderer = Helper::SDL_CreateRenderer498(window, -1, SDL_RENDERER_PRESENTVSYNC + SDL_RENDERER_ACCELERATED);
+    // Only wait on the display when vsync is how frames are paced, otherwise the FramePacer and vsync would both throttle
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if (FramePacer::UsesVSync())
+    {
+        rendererFlags += SDL_RENDERER_PRESENTVSYNC;
+    }
+    renderer = Helper::SDL_CreateRenderer498(window, -1, rendererFlags);
     SDL_SetRenderDrawColor(renderer, clear_r, clear_g, clear_b, 255);
     SDL_RenderClear(renderer);
 }
 
-// Adds text to be drawn to the textToDraw vector with the given parameters
+// Adds text to be drawn to the frame being recorded with the given parameters
 void Renderer::DrawText(const std::string& text_content, float x, float y, std::string font_name, float font_size, float r, float g, float b, float a)
 {
     Text newText;
@@ -63,7 +78,7 @@ void Renderer::DrawText(const std::string& text_content, float x, float y, std::
     newText.x = static_cast<int>(x);
     newText.y = static_cast<int>(y);
     
-    textToDraw.push(newText);
+    frames[recordingFrame].texts.push_back(newText);
 }
 
 // Draws UI
@@ -86,9 +101,9 @@ void Renderer::DrawUI(std::string imageName, float x, float y)
     newImage.color.a = 255;
     
     newImage.sortingOrder = 0;
-    newImage.requestOrder = static_cast<int>(UIImagesToDraw.size());
+    newImage.requestOrder = static_cast<int>(frames[recordingFrame].UIImages.size());
     
-    UIImagesToDraw.push(newImage);
+    frames[recordingFrame].UIImages.push_back(newImage);
 }
 
 // Draws UI with some extra parameters
@@ -111,9 +126,9 @@ void Renderer::DrawUIEx(std::string imageName, float x, float y, float r, float
     newImage.color.a = static_cast<int>(a);
     
     newImage.sortingOrder = static_cast<int>(sortingOrder);
-    newImage.requestOrder = static_cast<int>(UIImagesToDraw.size());
+    newImage.requestOrder = static_cast<int>(frames[recordingFrame].UIImages.size());
     
-    UIImagesToDraw.push(newImage);
+    frames[recordingFrame].UIImages.push_back(newImage);
 }
 
 // Draws a scene space image
@@ -136,9 +151,9 @@ void Renderer::Draw(std::string imageName, float x, float y)
     newImage.color.a = 255;
     
     newImage.sortingOrder = 0;
-    newImage.requestOrder = static_cast<int>(sceneImagesToDraw.size());
+    newImage.requestOrder = static_cast<int>(frames[recordingFrame].sceneImages.size());
     
-    sceneImagesToDraw.push(newImage);
+    frames[recordingFrame].sceneImages.push_back(newImage);
 }
 
 // Draws a scene space image with some extra parameters
@@ -161,9 +176,39 @@ void Renderer::DrawEx(std::string imageName, float x, float y, float rotationDeg
     newImage.color.a = static_cast<int>(a);
     
     newImage.sortingOrder = static_cast<int>(sortingOrder);
-    newImage.requestOrder = static_cast<int>(sceneImagesToDraw.size());
+    newImage.requestOrder = static_cast<int>(frames[recordingFrame].sceneImages.size());
+    
+    frames[recordingFrame].sceneImages.push_back(newImage);
+}
+
+// Draws a scene space image where a transform is in the world, with its world rotation and scale
+void Renderer::DrawTransform(std::string imageName, Transform* transform, float sortingOrder)
+{
+    if (transform == nullptr) {return;}
+    
+    b2Vec2 position = transform->GetWorldPosition();
+    b2Vec2 scale = transform->GetWorldScale();
+    
+    Image newImage;
+    newImage.imageName = imageName;
+    
+    newImage.x = position.x;
+    newImage.y = position.y;
+    newImage.rotationDegrees = static_cast<int>(transform->GetWorldRotation());
+    newImage.scaleX = scale.x;
+    newImage.scaleY = scale.y;
+    newImage.pivotX = 0.5f;
+    newImage.pivotY = 0.5f;
+    
+    newImage.color.r = 255;
+    newImage.color.g = 255;
+    newImage.color.b = 255;
+    newImage.color.a = 255;
+    
+    newImage.sortingOrder = static_cast<int>(sortingOrder);
+    newImage.requestOrder = static_cast<int>(frames[recordingFrame].sceneImages.size());
     
-    sceneImagesToDraw.push(newImage);
+    frames[recordingFrame].sceneImages.push_back(newImage);
 }
 
 // Draws a pixel on the screen
@@ -179,26 +224,86 @@ void Renderer::DrawPixel(float x, float y, float r, float g, float b, float a)
     newPixel.color.b = static_cast<int>(b);
     newPixel.color.a = static_cast<int>(a);
     
-    pixelsToDraw.push(newPixel);
+    frames[recordingFrame].pixels.push_back(newPixel);
 }
 
 // Renders all of the needed text and images in proper order
 void Renderer::Render()
 {
-    RenderSceneSpaceImages();
-    RenderUIImages();
-    RenderText();
-    RenderPixels();
+    RenderFrame& recorded = frames[recordingFrame];
+    drawCallsSubmitted += recorded.sceneImages.size() + recorded.UIImages.size() + recorded.texts.size() + recorded.pixels.size();
+    
+    // Headless runs throw away everything that was drawn
+    if (EngineUtils::headless)
+    {
+        recorded.Clear();
+        return;
+    }
+    
+    // The camera can move before the frame gets built, so it's captured with the frame
+    recorded.camera = SceneDB::currentScene.camera;
+    
+    // The autograder checks every frame's draw calls as they're presented, so it always gets the synchronous path
+    if (!pipelined || Helper::_autograder_mode)
+    {
+        BuildFrame(recorded);
+        SubmitFrame(recorded);
+        recorded.Clear();
+        return;
+    }
+    
+    // The frame recorded last time has been building while this frame's scripts ran
+    JobSystem::Wait(&buildCounter);
+    RenderFrame& built = frames[1 - recordingFrame];
+    if (built.readyToSubmit)
+    {
+        SubmitFrame(built);
+    }
+    built.Clear();
+    
+    // Builds this frame while the next one is updated, and records the next frame into the other buffer
+    JobSystem::Run([&recorded]() {BuildFrame(recorded);}, &buildCounter);
+    recordingFrame = 1 - recordingFrame;
+}
+
+// Sorts a recorded frame and works out all of its draw commands, doesn't touch SDL so it can run on a worker
+void Renderer::BuildFrame(RenderFrame& frame)
+{
+    std::sort(frame.sceneImages.begin(), frame.sceneImages.end(), ImageOrderComparator());
+    std::sort(frame.UIImages.begin(), frame.UIImages.end(), ImageOrderComparator());
+    
+    BuildDrawCommands(frame.sceneImages, frame.sceneCommands, &frame.camera);
+    BuildDrawCommands(frame.UIImages, frame.UICommands, nullptr);
+    
+    frame.readyToSubmit = true;
+}
+
+// Sends a built frame to SDL, has to run on the main thread
+void Renderer::SubmitFrame(RenderFrame& frame)
+{
+    RenderSceneSpaceImages(frame);
+    RenderUIImages(frame);
+    RenderText(frame);
+    RenderPixels(frame);
 }
 
-// Draws all the text in the textToDraw vector to the window
-void Renderer::RenderText()
+// Empties the frame so it can be recorded into again (keeps the memory around)
+void RenderFrame::Clear()
 {
-    while (!textToDraw.empty())
+    sceneImages.clear();
+    UIImages.clear();
+    texts.clear();
+    pixels.clear();
+    sceneCommands.clear();
+    UICommands.clear();
+    readyToSubmit = false;
+}
+
+// Draws all the text in the frame to the window
+void Renderer::RenderText(RenderFrame& frame)
+{
+    for (const Text& t : frame.texts)
     {
-        Text t = textToDraw.front();
-        textToDraw.pop();
-        
         SDL_Rect rect;
         rect.x = t.x;
         rect.y = t.y;
@@ -214,119 +319,150 @@ void Renderer::RenderText()
     }
 }
 
-// Draws all the images in the sceneImagesToDraw queue to the window
-void Renderer::RenderSceneSpaceImages()
+// Draws all the scene space images in the frame to the window
+void Renderer::RenderSceneSpaceImages(RenderFrame& frame)
 {
-    SDL_RenderSetScale(renderer, SceneDB::currentScene.camera.zoom, SceneDB::currentScene.camera.zoom);
-    while (!sceneImagesToDraw.empty())
+    SDL_RenderSetScale(renderer, frame.camera.zoom, frame.camera.zoom);
+    SubmitDrawCommands(frame.sceneImages, frame.sceneCommands);
+    SDL_RenderSetScale(renderer, 1, 1);
+}
+
+// Draws all the UI images in the frame to the window
+void Renderer::RenderUIImages(RenderFrame& frame)
+{
+    SubmitDrawCommands(frame.UIImages, frame.UICommands);
+}
+
+// Works out the draw command for every image across the job system
+void Renderer::BuildDrawCommands(const std::vector<Image>& images, std::vector<DrawCommand>& commands, const Camera* camera)
+{
+    commands.resize(images.size());
+    JobSystem::ParallelFor(static_cast<int>(images.size()), 512, [&images, &commands, camera](int start, int end)
     {
-        Image i = sceneImagesToDraw.top();
-        sceneImagesToDraw.pop();
-        
-        float posX = 0.0f;
-        float posY = 0.0f;
-        
-        SDL_Rect rect;
-        SDL_Point center;
-        // Gets the width of the image to render
-        SDL_QueryTexture(ImageDB::GetImage(i.imageName), NULL, NULL, &rect.w, &rect.h);
-        
-        // Apply scale
-        int flip = SDL_FLIP_NONE;
-        if (i.scaleX < 0) {flip |= SDL_FLIP_HORIZONTAL;}
-        if (i.scaleY < 0) {flip |= SDL_FLIP_VERTICAL;}
-            
-        rect.w *= std::abs((i.scaleX));
-        rect.h *= std::abs((i.scaleY));
-        
-        center.x = static_cast<int>(rect.w * i.pivotX);
-        center.y = static_cast<int>(rect.h * i.pivotY);
-        
-        // Baseline position relative to the camera
-        posX = i.x - SceneDB::currentScene.camera.position.x;
-        posY = i.y - SceneDB::currentScene.camera.position.y;
-        
-        // Offset by camera offset values
-        posX = (posX - SceneDB::currentScene.camera.offsetX) * PIXELS_PER_UNIT;
-        posY = (posY - SceneDB::currentScene.camera.offsetY) * PIXELS_PER_UNIT;
-        
-        // Centers the actors position on the center of the camera
-        posX += SceneDB::currentScene.camera.cameraWidth * 0.5f * (1.0f / SceneDB::currentScene.camera.zoom);
-        posY += SceneDB::currentScene.camera.cameraHeight * 0.5f * (1.0f / SceneDB::currentScene.camera.zoom);
-        
-        // Offsets the render position by the pivot ammount
-        posX -= center.x;
-        posY -= center.y;
+        for (int i = start; i < end; i++)
+        {
+            commands[i] = camera != nullptr ? BuildSceneDrawCommand(images[i], *camera) : BuildUIDrawCommand(images[i]);
+        }
+    });
+}
+
+// Works out where a scene space image lands on the screen
+DrawCommand Renderer::BuildSceneDrawCommand(const Image& i, const Camera& camera)
+{
+    DrawCommand command;
     
-        // Cast the position to ints so they can represent pixels on the screen
-        rect.x = static_cast<int>(posX);
-        rect.y = static_cast<int>(posY);
-        
-        //if (!IsImageInCamera(rect.x, rect.y, rect.w, rect.h)) {continue;}
-        
-        // Sets the correct color and alpha to the texture
-        SDL_SetTextureColorMod(ImageDB::GetImage(i.imageName), i.color.r, i.color.g, i.color.b);
-        SDL_SetTextureAlphaMod(ImageDB::GetImage(i.imageName), i.color.a);
+    float posX = 0.0f;
+    float posY = 0.0f;
+    
+    SDL_Rect& rect = command.rect;
+    SDL_Point& center = command.center;
+    // Gets the width of the image to render
+    command.imageFound = ImageDB::FindImage(i.imageName, command.texture, rect.w, rect.h);
+    if (!command.imageFound) {return command;}
+    
+    // Apply scale
+    int flip = SDL_FLIP_NONE;
+    if (i.scaleX < 0) {flip |= SDL_FLIP_HORIZONTAL;}
+    if (i.scaleY < 0) {flip |= SDL_FLIP_VERTICAL;}
         
-        Helper::SDL_RenderCopyEx498(-1, "dummy", renderer, ImageDB::GetImage(i.imageName), NULL, &rect, static_cast<int>(i.rotationDegrees), &center, (SDL_RendererFlip)flip);
+    rect.w *= std::abs((i.scaleX));
+    rect.h *= std::abs((i.scaleY));
+    
+    center.x = static_cast<int>(rect.w * i.pivotX);
+    center.y = static_cast<int>(rect.h * i.pivotY);
+    
+    // Baseline position relative to the camera
+    posX = i.x - camera.position.x;
+    posY = i.y - camera.position.y;
+    
+    // Offset by camera offset values
+    posX = (posX - camera.offsetX) * PIXELS_PER_UNIT;
+    posY = (posY - camera.offsetY) * PIXELS_PER_UNIT;
+    
+    // Centers the actors position on the center of the camera
+    posX += camera.cameraWidth * 0.5f * (1.0f / camera.zoom);
+    posY += camera.cameraHeight * 0.5f * (1.0f / camera.zoom);
+    
+    // Offsets the render position by the pivot ammount
+    posX -= center.x;
+    posY -= center.y;
 
-        // Removes the color and alpha from the texture
-        SDL_SetTextureColorMod(ImageDB::GetImage(i.imageName), 255, 255, 255);
-        SDL_SetTextureAlphaMod(ImageDB::GetImage(i.imageName), 255);
-    }
-    SDL_RenderSetScale(renderer, 1, 1);
+    // Cast the position to ints so they can represent pixels on the screen
+    rect.x = static_cast<int>(posX);
+    rect.y = static_cast<int>(posY);
+    
+    //if (!IsImageInCamera(rect.x, rect.y, rect.w, rect.h)) {continue;}
+    
+    command.rotationDegrees = i.rotationDegrees;
+    command.flip = flip;
+    command.color = i.color;
+    return command;
 }
 
-// Draws all the images in the UIImagesToDraw queue to the window
-void Renderer::RenderUIImages()
+// Works out where a UI image lands on the screen
+DrawCommand Renderer::BuildUIDrawCommand(const Image& i)
 {
-    while (!UIImagesToDraw.empty())
+    DrawCommand command;
+    
+    SDL_Point& center = command.center;
+    SDL_Rect& rect = command.rect;
+    // Gets the width of the image to render
+    command.imageFound = ImageDB::FindImage(i.imageName, command.texture, rect.w, rect.h);
+    if (!command.imageFound) {return command;}
+    
+    // Apply scale
+    int flip = SDL_FLIP_NONE;
+    if (i.scaleX < 0) {flip |= SDL_FLIP_HORIZONTAL;}
+    if (i.scaleY < 0) {flip |= SDL_FLIP_VERTICAL;}
+    
+    rect.w *= std::abs(static_cast<int>(i.scaleX));
+    rect.h *= std::abs(static_cast<int>(i.scaleY));
+    
+    // Calculate the center point of the image
+    center.x = static_cast<int>(rect.w * i.pivotX);
+    center.y = static_cast<int>(rect.h * i.pivotY);
+    
+    // The screen position in pixels to print the Ui image at
+    rect.x = static_cast<int>(i.x);
+    rect.y = static_cast<int>(i.y);
+    
+    command.rotationDegrees = i.rotationDegrees;
+    command.flip = flip;
+    command.color = i.color;
+    return command;
+}
+
+// Sends the built draw commands to SDL in order, has to run on the main thread
+void Renderer::SubmitDrawCommands(const std::vector<Image>& images, const std::vector<DrawCommand>& commands)
+{
+    for (int i = 0; i < images.size(); i++)
     {
-        Image i = UIImagesToDraw.top();
-        UIImagesToDraw.pop();
+        const DrawCommand& command = commands[i];
         
-        SDL_Point center;
-        SDL_Rect rect;
-        // Gets the width of the image to render
-        SDL_QueryTexture(ImageDB::GetImage(i.imageName), NULL, NULL, &rect.w, &rect.h);
-        
-        // Apply scale
-        int flip = SDL_FLIP_NONE;
-        if (i.scaleX < 0) {flip |= SDL_FLIP_HORIZONTAL;}
-        if (i.scaleY < 0) {flip |= SDL_FLIP_VERTICAL;}
-        
-        rect.w *= std::abs(static_cast<int>(i.scaleX));
-        rect.h *= std::abs(static_cast<int>(i.scaleY));
-        
-        // Calculate the center point of the image
-        center.x = static_cast<int>(rect.w * i.pivotX);
-        center.y = static_cast<int>(rect.h * i.pivotY);
-        
-        // The screen position in pixels to print the Ui image at
-        rect.x = static_cast<int>(i.x);
-        rect.y = static_cast<int>(i.y);
+        // Reports the missing image the same way every other lookup does
+        if (!command.imageFound)
+        {
+            ImageDB::GetImage(images[i].imageName);
+        }
         
         // Sets the correct color and alpha to the texture
-        SDL_SetTextureColorMod(ImageDB::GetImage(i.imageName), i.color.r, i.color.g, i.color.b);
-        SDL_SetTextureAlphaMod(ImageDB::GetImage(i.imageName), i.color.a);
+        SDL_SetTextureColorMod(command.texture, command.color.r, command.color.g, command.color.b);
+        SDL_SetTextureAlphaMod(command.texture, command.color.a);
         
-        Helper::SDL_RenderCopyEx498(-1, "dummy", renderer, ImageDB::GetImage(i.imageName), NULL, &rect, static_cast<int>(i.rotationDegrees), &center, (SDL_RendererFlip)flip);
+        Helper::SDL_RenderCopyEx498(-1, "dummy", renderer, command.texture, NULL, &command.rect, command.rotationDegrees, &command.center, (SDL_RendererFlip)command.flip);
         
         // Removes the color and alpha from the texture
-        SDL_SetTextureColorMod(ImageDB::GetImage(i.imageName), 255, 255, 255);
-        SDL_SetTextureAlphaMod(ImageDB::GetImage(i.imageName), 255);
+        SDL_SetTextureColorMod(command.texture, 255, 255, 255);
+        SDL_SetTextureAlphaMod(command.texture, 255);
     }
 }
 
-// Draws all the pixels in the pixelsToDraw queue to the window
-void Renderer::RenderPixels()
+// Draws all the pixels in the frame to the window
+void Renderer::RenderPixels(RenderFrame& frame)
 {
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-    while (!pixelsToDraw.empty())
+    for (const Pixel& p : frame.pixels)
     {
-        Pixel p = pixelsToDraw.front();
-        pixelsToDraw.pop();
-        
         SDL_SetRenderDrawColor(renderer, p.color.r, p.color.g, p.color.b, p.color.a);
         SDL_RenderDrawPoint(renderer, p.x, p.y);
         SDL_SetRenderDrawColor(renderer, clear_r, clear_g, clear_b, 255);
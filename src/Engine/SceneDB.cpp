@@ -8,126 +8,522 @@
 //  School Email: mrjacob@umich.edu
 
 #include <stdio.h>
+#include <algorithm>
 
 #include "SceneDB.h"
+#include "ActorPool.h"
+#include "NativeComponentDB.h"
+#include "CoroutineScheduler.h"
+#include "Profiler.h"
+#include "Application.h"
+#include "TimeHandler.h"
 
 // Scene Class:
 // Update all of the actors in this scene
 void Scene::UpdateActors()
 {
+    PROFILE_SCOPE("Scene::UpdateActors");
+    
     // Add all of the new actors to this scene
-    for (auto actor : actorsToAdd)
     {
-        actor->Start();
-        
-        // Initializes all components added to new actors at runtime
-        actor->InitNewComponents();
+        PROFILE_SCOPE("AddNewActors");
+        actors.Reserve(actors.size() + actorsToAdd.size());
+        for (auto actor : actorsToAdd)
+        {
+            actor->Start();
+            actor->pending = false;
+            
+            // Initializes all components added to new actors at runtime
+            actor->InitNewComponents();
+            
+            actors.Insert(actor);
+            AddNewComponentsToDispatchLists(actor.get());
+            QueueAddedComponents(actor.get());
+        }
+        actorsToAdd.clear();
         
-        actors[actor->ID] = actor;
+        SortDispatchLists();
     }
-    actorsToAdd.clear();
     
     // Process all of the components added to actors this frame
-    for (auto actor : actors)
     {
-        actor.second->ProcessAddedComponents();
+        PROFILE_SCOPE("ProcessAddedComponents");
+        ProcessAddedComponents();
     }
     
     // Update all actors
-    for (auto actor : actors)
     {
-        actor.second->Update();
+        PROFILE_SCOPE("Update");
+        DispatchUpdate(updateList);
+        
+        // When updates are grouped by type, C++ components that update in batches aren't in the update list
+        if (SceneDB::groupUpdatesByType)
+        {
+            NativeComponentDB::BatchUpdate();
+        }
+    }
+    
+    // Resume coroutines that are done waiting
+    {
+        PROFILE_SCOPE("Coroutines");
+        CoroutineScheduler::Update();
     }
     
     // Late update all actors
-    for (auto actor : actors)
     {
-        actor.second->LateUpdate();
+        PROFILE_SCOPE("LateUpdate");
+        Dispatch(lateUpdateList);
         
         // Initializes all components added to existing actors at runtime
-        actor.second->InitNewComponents();
+        InitNewComponents();
+        SortDispatchLists();
     }
     
     // Processes all of the components removed from actors this frame
-    for (auto actor : actors)
     {
-        actor.second->ProcessRemovedComponents();
+        PROFILE_SCOPE("ProcessRemovedComponents");
+        if (ProcessRemovedComponents())
+        {
+            dispatchListsDirty = true;
+        }
+        
+        // Destroyed actors have to be out of the lists before they are freed
+        if (dispatchListsDirty || !actorsToDestroy.empty())
+        {
+            CleanDispatchLists();
+        }
     }
     
     // Destroys all of the needed actors
-    for (auto actorID : actorsToDestroy)
+    DestroyActors();
+}
+
+// Orders queued actors by ID, the order the scene used to go through them in
+static bool ActorIDLess(const Actor* a, const Actor* b)
+{
+    return a->ID < b->ID;
+}
+
+// Starts the components added to the actors queued for it, actors with components that are still disabled stay queued
+void Scene::ProcessAddedComponents()
+{
+    std::sort(actorsWithAddedComponents.begin(), actorsWithAddedComponents.end(), ActorIDLess);
+    
+    // "OnStart" can queue more actors, they are started in this pass too
+    size_t stillQueued = 0;
+    for (size_t i = 0; i < actorsWithAddedComponents.size(); i++)
     {
-        Actor* toDestroy = nullptr;
-        if (actors.find(actorID) != actors.end())
+        Actor* actor = actorsWithAddedComponents[i];
+        actor->ProcessAddedComponents();
+        
+        if (actor->componentsToAdd.empty())
         {
-            toDestroy = actors[actorID].get();
-            actors.erase(actorID);
+            actor->queuedAddedComponents = false;
         }
         else
         {
-            // Remove from the actors to add vector if this actor hasn't been loaded yet
-            int indexToRemove = -1;
-            for (int i = 0; i < actorsToAdd.size(); i++)
-            {
-                if (actorID == actorsToAdd[i]->ID)
-                {
-                    indexToRemove = i;
-                }
-            }
-            
-            if (indexToRemove != -1)
-            {
-                toDestroy = actorsToAdd[indexToRemove].get();
-                actorsToAdd.erase(actorsToAdd.begin() + indexToRemove);
-            }
+            actorsWithAddedComponents[stillQueued] = actor;
+            stillQueued++;
+        }
+    }
+    actorsWithAddedComponents.resize(stillQueued);
+}
+
+// Initializes the components added at runtime to the actors queued for it
+void Scene::InitNewComponents()
+{
+    std::sort(actorsWithNewComponents.begin(), actorsWithNewComponents.end(), ActorIDLess);
+    
+    for (Actor* actor : actorsWithNewComponents)
+    {
+        actor->queuedNewComponents = false;
+        actor->InitNewComponents();
+        AddNewComponentsToDispatchLists(actor);
+        QueueAddedComponents(actor);
+    }
+    actorsWithNewComponents.clear();
+}
+
+// Removes the components removed from the actors queued for it, returns true if any were removed
+bool Scene::ProcessRemovedComponents()
+{
+    std::sort(actorsWithRemovedComponents.begin(), actorsWithRemovedComponents.end(), ActorIDLess);
+    
+    // "OnDestroy" can queue more actors, they are processed in this pass too
+    bool removedAny = false;
+    size_t stillQueued = 0;
+    for (size_t i = 0; i < actorsWithRemovedComponents.size(); i++)
+    {
+        Actor* actor = actorsWithRemovedComponents[i];
+        
+        // Actors still being added to the scene keep their removed components until they are in it
+        if (!actors.Contains(actor))
+        {
+            actorsWithRemovedComponents[stillQueued] = actor;
+            stillQueued++;
+            continue;
         }
         
-        // Removes them from the immortal actors vector if they are marked as immortal
-        if (toDestroy != nullptr && !toDestroy->destroyOnLoad)
+        actor->queuedRemovedComponents = false;
+        if (actor->ProcessRemovedComponents())
         {
-            int indexToRemove = -1;
-            for (int i = 0; i < immortalActors.size(); i++)
-            {
-                if (actorID == immortalActors[i]->ID)
-                {
-                    indexToRemove = i;
-                }
-            }
-            
-            if (indexToRemove != -1)
+            removedAny = true;
+        }
+    }
+    actorsWithRemovedComponents.resize(stillQueued);
+    
+    return removedAny;
+}
+
+// Marks an actor as having components to initialize, start or remove.
+// Each frame the scene only goes through the actors marked for each step.
+void Scene::QueueNewComponents(Actor* actor)
+{
+    if (actor->queuedNewComponents) {return;}
+    actor->queuedNewComponents = true;
+    actorsWithNewComponents.push_back(actor);
+}
+
+void Scene::QueueAddedComponents(Actor* actor)
+{
+    if (actor->queuedAddedComponents || actor->componentsToAdd.empty()) {return;}
+    actor->queuedAddedComponents = true;
+    actorsWithAddedComponents.push_back(actor);
+}
+
+void Scene::QueueRemovedComponents(Actor* actor)
+{
+    if (actor->queuedRemovedComponents) {return;}
+    actor->queuedRemovedComponents = true;
+    actorsWithRemovedComponents.push_back(actor);
+}
+
+// Removes the actors destroyed this frame from every list the scene keeps them in
+void Scene::DestroyActors()
+{
+    PROFILE_SCOPE("DestroyActors");
+    if (actorsToDestroy.empty()) {return;}
+    
+    // Keeps the actors alive until they are out of every list, actors that haven't been added yet have a handle too
+    bool destroyedPending = false;
+    bool destroyedImmortal = false;
+    for (Actor* actor : actorsToDestroy)
+    {
+        std::shared_ptr<Actor> toDestroy = actors.GetShared(actor->handle);
+        if (toDestroy == nullptr || toDestroy.get() != actor) {continue;}
+        destroyedHandles.push_back(actor->handle);
+        destroyedActors.push_back(std::move(toDestroy));
+        
+        if (actor->pending)
+        {
+            destroyedPending = true;
+        }
+        
+        if (!actor->destroyOnLoad)
+        {
+            destroyedImmortal = true;
+        }
+    }
+    
+    // Actors that haven't been loaded yet are taken out of the actors to add, keeping the rest in order
+    if (destroyedPending)
+    {
+        auto takeDestroyed = [](const std::shared_ptr<Actor>& actor)
+        {
+            if (!actor->destroyed) {return false;}
+            actor->pending = false;
+            return true;
+        };
+        actorsToAdd.erase(std::remove_if(actorsToAdd.begin(), actorsToAdd.end(), takeDestroyed), actorsToAdd.end());
+    }
+    
+    // Removes them from the immortal actors vector if they are marked as immortal
+    if (destroyedImmortal)
+    {
+        auto destroyed = [](const std::shared_ptr<Actor>& actor) {return actor->destroyed;};
+        immortalActors.erase(std::remove_if(immortalActors.begin(), immortalActors.end(), destroyed), immortalActors.end());
+    }
+    
+    // Anything still queued for them is dropped
+    for (std::vector<Actor*>* queue : {&actorsWithNewComponents, &actorsWithAddedComponents, &actorsWithRemovedComponents})
+    {
+        queue->erase(std::remove_if(queue->begin(), queue->end(), [](const Actor* actor) {return actor->destroyed;}), queue->end());
+    }
+    for (auto& actor : destroyedActors)
+    {
+        actor->queuedNewComponents = false;
+        actor->queuedAddedComponents = false;
+        actor->queuedRemovedComponents = false;
+    }
+    
+    // Find can't return them anymore
+    RemoveFromIndex(destroyedActors);
+    
+    actors.Remove(destroyedHandles);
+    
+    // The next instantiation of their templates can reuse them
+    for (auto& actor : destroyedActors)
+    {
+        ActorPool::Return(std::move(actor));
+    }
+    
+    destroyedActors.clear();
+    destroyedHandles.clear();
+    actorsToDestroy.clear();
+}
+
+// Runs one fixed simulation tick on all of the actors in this scene
+void Scene::FixedUpdateActors()
+{
+    PROFILE_SCOPE("Scene::FixedUpdateActors");
+    Dispatch(fixedUpdateList);
+}
+
+// Adds the components to the end of the update lists they have lifecycle functions for
+void Scene::AddToDispatchLists(Actor* actor, const std::vector<std::shared_ptr<ComponentRecord>>& components)
+{
+    for (auto& component : components)
+    {
+        DispatchEntry entry = {actor, component, component->typeIndex, actor->ID, component->initOrder};
+        
+        // C++ components with a batch update get it instead of OnUpdate, but only when the game has asked for updates to be grouped by type
+        bool batchUpdated = SceneDB::groupUpdatesByType && component->native != nullptr && component->native->batchUpdate != nullptr;
+        
+        for (DispatchList* list : {&updateList, &fixedUpdateList, &lateUpdateList})
+        {
+            if (list == &updateList && batchUpdated) {continue;}
+            if (component->HasFunction(list->function))
             {
-                immortalActors.erase(immortalActors.begin() + indexToRemove);
+                list->entries.push_back(entry);
             }
         }
+    }
+}
+
+// Adds the components the actor initialized since the last time this was called
+void Scene::AddNewComponentsToDispatchLists(Actor* actor)
+{
+    if (actor->newComponents.empty()) {return;}
+    
+    AddToDispatchLists(actor, actor->newComponents);
+    actor->newComponents.clear();
+}
+
+// Sorts the entries added to the update lists into place
+void Scene::SortDispatchLists()
+{
+    for (DispatchList* list : {&updateList, &fixedUpdateList, &lateUpdateList})
+    {
+        if (list->sortedCount == list->entries.size()) {continue;}
         
-        //delete actor;
+        // New entries are sorted on their own and merged into the rest, which are already in order
+        auto firstNewEntry = list->entries.begin() + list->sortedCount;
+        std::sort(firstNewEntry, list->entries.end(), DispatchOrder);
+        std::inplace_merge(list->entries.begin(), firstNewEntry, list->entries.end(), DispatchOrder);
+        
+        list->sortedCount = list->entries.size();
+    }
+}
+
+// Drops removed components and destroyed actors from the update lists
+void Scene::CleanDispatchLists()
+{
+    for (DispatchList* list : {&updateList, &fixedUpdateList, &lateUpdateList})
+    {
+        auto removed = [](const DispatchEntry& entry) {return entry.component->removed || entry.actor->destroyed;};
+        list->entries.erase(std::remove_if(list->entries.begin(), list->entries.end(), removed), list->entries.end());
+        list->sortedCount = list->entries.size();
+    }
+    
+    dispatchListsDirty = false;
+}
+
+// Calls the list's lifecycle function on every enabled and started component in it
+void Scene::Dispatch(const DispatchList& list)
+{
+    for (const DispatchEntry& entry : list.entries)
+    {
+        // Don't update this Actor if it isn't enabled
+        if (entry.actor->enabled == false) {continue;}
+        
+        // Don't update this component if it isn't enabled or hasn't had a chance to run its "OnStart" function (if it exists)
+        if (!entry.component->IsActive()) {continue;}
+        
+        entry.component->Call(list.function, entry.actor->name);
     }
-    actorsToDestroy.clear();
+}
+
+// Calls OnUpdate on every enabled and started component whose update policy lets it run this frame,
+// along with the time since its last update
+void Scene::DispatchUpdate(DispatchList& list)
+{
+    int frame = Application::GetFrame();
+    float deltaTime = TimeHandler::deltaTime;
+    
+    for (DispatchEntry& entry : list.entries)
+    {
+        // Don't update this Actor if it isn't enabled
+        if (entry.actor->enabled == false) {continue;}
+        
+        // Don't update this component if it isn't enabled or hasn't had a chance to run its "OnStart" function (if it exists)
+        if (!entry.component->IsActive()) {continue;}
+        
+        // Time only builds up while the component could be updating
+        entry.accumulatedTime += deltaTime;
+        if (entry.component->updatePolicy != UPDATE_EVERY_FRAME && !IsUpdateDue(entry, frame)) {continue;}
+        
+        entry.component->Call(ON_UPDATE, entry.accumulatedTime, entry.actor->name);
+        entry.accumulatedTime = 0.0f;
+    }
+}
+
+// Returns true if a throttled component should be updated this frame.
+// Ticks are staggered by actor ID so components on the same interval don't all run on the same frame
+bool Scene::IsUpdateDue(const DispatchEntry& entry, int frame)
+{
+    const ComponentRecord& component = *entry.component;
+    int interval = component.updateInterval;
+    
+    if (component.updatePolicy == UPDATE_DORMANT_OFF_CAMERA)
+    {
+        return GetDistanceOffCamera(entry.actor, frame) <= SceneDB::updateLODMargin;
+    }
+    if (component.updatePolicy == UPDATE_BY_DISTANCE)
+    {
+        float distance = GetDistanceOffCamera(entry.actor, frame);
+        if (distance <= SceneDB::updateLODMargin) {return true;}
+        
+        // Off camera it updates every other frame, with one more frame between updates for every screen further away, up to its interval
+        float screenSize = std::max(camera.cameraWidth, camera.cameraHeight) / (Renderer::PIXELS_PER_UNIT * camera.zoom);
+        interval = std::min(interval, 2 + static_cast<int>(distance / screenSize));
+    }
+    if (interval <= 1) {return true;}
+    
+    return (frame + entry.actorID) % interval == 0;
+}
+
+// How far the actor is outside the camera's view in world units, 0 if it is in view or has no position
+float Scene::GetDistanceOffCamera(Actor* actor, int frame)
+{
+    if (actor->cameraDistanceFrame == frame) {return actor->cameraDistance;}
+    actor->cameraDistanceFrame = frame;
+    actor->cameraDistance = 0.0f;
+    
+    b2Vec2 position;
+    if (!actor->GetWorldPosition(position)) {return 0.0f;}
+    
+    // The same view the renderer draws, the camera's size is in pixels at a zoom of 1
+    float halfWidth = camera.cameraWidth * 0.5f / (Renderer::PIXELS_PER_UNIT * camera.zoom);
+    float halfHeight = camera.cameraHeight * 0.5f / (Renderer::PIXELS_PER_UNIT * camera.zoom);
+    float distanceX = std::max(std::abs(position.x - (camera.position.x + camera.offsetX)) - halfWidth, 0.0f);
+    float distanceY = std::max(std::abs(position.y - (camera.position.y + camera.offsetY)) - halfHeight, 0.0f);
+    
+    actor->cameraDistance = std::sqrt(distanceX * distanceX + distanceY * distanceY);
+    return actor->cameraDistance;
+}
+
+// The order components are called in, by type then actor if updates are grouped by type
+bool Scene::DispatchOrder(const DispatchEntry& a, const DispatchEntry& b)
+{
+    if (SceneDB::groupUpdatesByType && a.typeIndex != b.typeIndex)
+    {
+        return a.typeIndex < b.typeIndex;
+    }
+    if (a.actorID != b.actorID)
+    {
+        return a.actorID < b.actorID;
+    }
+    return a.initOrder < b.initOrder;
 }
 
 // Adds a new actor into this scene and returns a reference to it.
 Actor* Scene::AddNewActor(std::string actor_template_name)
 {
-    // Ensures correct copying of components:
-    Actor temp;
-    temp = TemplateDB::GetTemplate(actor_template_name);
+    return AddNewActor(TemplateDB::GetBlueprint(actor_template_name));
+}
+
+// Adds count new actors made from the same template into this scene and appends them to newActors.
+// The template is looked up and the scene's storage is grown once for the whole batch.
+void Scene::AddNewActors(std::string actor_template_name, int count, std::vector<Actor*>& newActors)
+{
+    if (count <= 0) {return;}
+    
+    const ActorBlueprint& blueprint = TemplateDB::GetBlueprint(actor_template_name);
+    
+    // Grows by at least double so spawning a batch every frame doesn't reallocate every frame
+    size_t needed = actorsToAdd.size() + count;
+    if (actorsToAdd.capacity() < needed)
+    {
+        actorsToAdd.reserve(std::max(needed, actorsToAdd.capacity() * 2));
+    }
+    newActors.reserve(newActors.size() + count);
     
-    std::shared_ptr<Actor> newActor = std::make_shared<Actor>(temp);
+    for (int i = 0; i < count; i++)
+    {
+        newActors.push_back(AddNewActor(blueprint));
+    }
+}
+
+// Adds a new actor made from a compiled template, reusing a pooled one if there is one
+Actor* Scene::AddNewActor(const ActorBlueprint& blueprint)
+{
+    // Reuses a destroyed actor made from this template if one is pooled
+    std::shared_ptr<Actor> newActor = ActorPool::Take(blueprint.templateName);
+    bool reused = newActor != nullptr;
+    
+    if (!reused)
+    {
+        newActor = std::make_shared<Actor>();
+        newActor->Clone(blueprint);
+    }
+    
+    // Lua can hold on to it as soon as it's instantiated, so it gets its handle now
     actorsToAdd.push_back(newActor);
+    actors.Claim(newActor);
+    newActor->pending = true;
+    AddToIndex(newActor.get());
     
     newActor->InitNewComponents();
     
+    // Lets components clear anything they kept outside of themselves last time they were used
+    if (reused)
+    {
+        newActor->CallOnReset();
+    }
+    
     return newActor.get();
 }
 
 // To be called when this scene is loaded into the current scene
 void Scene::Init()
 {
-    // Adds all of the immortal actors to the actors vector since they've already been processed
+    // Adds all of the immortal actors to the actors vector since they've already been processed.
+    // They keep the handles they had in the last scene
     for (auto actor : immortalActors)
     {
-        actors[actor->ID] = actor;
+        actors.Insert(actor);
+        actor->pending = false;
+        AddToIndex(actor.get());
+        
+        // Whatever they had queued in the last scene is queued again in this one
+        actor->queuedNewComponents = false;
+        actor->queuedAddedComponents = false;
+        actor->queuedRemovedComponents = false;
+        QueueNewComponents(actor.get());
+        QueueAddedComponents(actor.get());
+        if (!actor->componentsToRemove.empty())
+        {
+            QueueRemovedComponents(actor.get());
+        }
+        
+        std::vector<std::shared_ptr<ComponentRecord>> components;
+        for (auto& component : actor->components)
+        {
+            components.push_back(component.second);
+        }
+        AddToDispatchLists(actor.get(), components);
     }
+    SortDispatchLists();
     
     // Adds all of the default actors to the actorsToAdd vector
     for (auto actor : defaultActors)
@@ -138,9 +534,86 @@ void Scene::Init()
         
         std::shared_ptr<Actor> newActor = std::make_shared<Actor>(def);
         actorsToAdd.push_back(newActor);
+        actors.Claim(newActor);
+        newActor->pending = true;
+        AddToIndex(newActor.get());
+    }
+}
+
+// Adds an actor to the name and tag indices
+void Scene::AddToIndex(Actor* actor)
+{
+    actorsByName[actor->name].push_back(actor);
+    
+    for (const std::string& tag : actor->tags)
+    {
+        actorsByTag[tag].push_back(actor);
+    }
+    
+    actor->indexed = true;
+}
+
+// Removes destroyed actors from the name and tag indices, each list they were in is only gone through once
+void Scene::RemoveFromIndex(const std::vector<std::shared_ptr<Actor>>& destroyedActors)
+{
+    // Many destroyed actors usually share a name or tag, so the lists they are in are collected first
+    for (auto& actor : destroyedActors)
+    {
+        if (!actor->indexed) {continue;}
+        
+        auto named = actorsByName.find(actor->name);
+        if (named != actorsByName.end()) {indexListsToCompact.push_back(&named->second);}
+        
+        for (const std::string& tag : actor->tags)
+        {
+            auto tagged = actorsByTag.find(tag);
+            if (tagged != actorsByTag.end()) {indexListsToCompact.push_back(&tagged->second);}
+        }
+    }
+    
+    std::sort(indexListsToCompact.begin(), indexListsToCompact.end());
+    indexListsToCompact.erase(std::unique(indexListsToCompact.begin(), indexListsToCompact.end()), indexListsToCompact.end());
+    
+    for (std::vector<Actor*>* list : indexListsToCompact)
+    {
+        list->erase(std::remove_if(list->begin(), list->end(), [](Actor* actor) {return actor->destroyed;}), list->end());
+    }
+    indexListsToCompact.clear();
+    
+    // Names and tags nothing has anymore are dropped
+    for (auto& actor : destroyedActors)
+    {
+        if (!actor->indexed) {continue;}
+        
+        auto named = actorsByName.find(actor->name);
+        if (named != actorsByName.end() && named->second.empty()) {actorsByName.erase(named);}
+        
+        for (const std::string& tag : actor->tags)
+        {
+            auto tagged = actorsByTag.find(tag);
+            if (tagged != actorsByTag.end() && tagged->second.empty()) {actorsByTag.erase(tagged);}
+        }
+        
+        actor->indexed = false;
     }
 }
 
+// Keeps the tag index up to date when tags change at runtime
+void Scene::AddTagToIndex(Actor* actor, const std::string& tag)
+{
+    actorsByTag[tag].push_back(actor);
+}
+
+void Scene::RemoveTagFromIndex(Actor* actor, const std::string& tag)
+{
+    auto indexed = actorsByTag.find(tag);
+    if (indexed == actorsByTag.end()) {return;}
+    
+    std::vector<Actor*>& tagged = indexed->second;
+    tagged.erase(std::remove(tagged.begin(), tagged.end(), actor), tagged.end());
+    if (tagged.empty()) {actorsByTag.erase(indexed);}
+}
+
 Scene::Scene()
 {
 }
@@ -157,7 +630,7 @@ Scene::Scene(rapidjson::Document *sceneDocument)
             // If the actor has a value for template, set the actors values to the templates values.
             if (member.HasMember("template"))
             {
-                newActor = TemplateDB::GetTemplate(member["template"].GetString());
+                newActor.Clone(TemplateDB::GetBlueprint(member["template"].GetString()));
             }
             
             newActor.LoadActorWithJSON(member);
@@ -186,6 +659,10 @@ Scene::~Scene()
 int SceneDB::numActorsLoaded = 0;
 // The current scene that the game is in
 Scene SceneDB::currentScene;
+// If true every component of a type is updated back to back, otherwise every actor's components are updated together
+bool SceneDB::groupUpdatesByType = false;
+// How far outside the camera's view (in world units) an actor still counts as on camera for update policies
+float SceneDB::updateLODMargin = 1.0f;
 // Stores if loading a new scene is needed and what the name of the scene is
 std::string SceneDB::nextScene = "";
 bool SceneDB::loadNewScene = false;
@@ -234,15 +711,15 @@ void SceneDB::ChangeScene(std::string newScene)
 void SceneDB::LoadNewScene()
 {
     // Destroys the current scene
-    for (auto& member : currentScene.actors)
+    for (Actor* actor : currentScene.actors)
     {
-        Destroy(member.second.get());
+        DestroyActor(actor);
     }
     
     // Destroys the current scene
-    for (auto& member : currentScene.actors)
+    for (Actor* actor : currentScene.actors)
     {
-        member.second.get()->ProcessRemovedComponents();
+        actor->ProcessRemovedComponents();
     }
     
     Scene newCurrentScene = GetScene(nextScene);
@@ -250,14 +727,33 @@ void SceneDB::LoadNewScene()
     // Transfers the immortal actors
     newCurrentScene.immortalActors = currentScene.immortalActors;
     
+    // The new scene takes over the slots so handles Lua kept to the old scene's actors can't point to its actors.
+    // Only the immortal actors keep theirs
+    std::vector<ActorHandle> leftBehind;
+    for (Actor* actor : currentScene.actors)
+    {
+        if (actor->destroyOnLoad) {leftBehind.push_back(actor->handle);}
+    }
+    for (auto& actor : currentScene.actorsToAdd)
+    {
+        if (actor->destroyOnLoad) {leftBehind.push_back(actor->handle);}
+    }
+    currentScene.actors.Remove(leftBehind);
+    newCurrentScene.actors = std::move(currentScene.actors);
+    
     currentScene = newCurrentScene;
     currentScene.Init();
 }
 
 // Makes it so the given actor persists throughout scene loads
-void SceneDB::DontDestroy(Actor* actor)
+void SceneDB::DontDestroy(ActorRef actor)
 {
-    std::shared_ptr<Actor> immortalActor = FindActorByID(actor->ID);
+    // Lua can pass in actors that were never found or have already been removed from the scene
+    std::shared_ptr<Actor> immortalActor = currentScene.actors.GetShared(actor.handle);
+    if (immortalActor == nullptr || !immortalActor->enabled) {return;}
+    
+    // Already immortal
+    if (!immortalActor->destroyOnLoad) {return;}
     
     immortalActor->destroyOnLoad = false;
     currentScene.immortalActors.push_back(immortalActor);
@@ -280,110 +776,143 @@ Scene SceneDB::GetScene(std::string sceneName)
     return loadedScenes[sceneName];
 }
 
-// Finds an actor in the currentScene that has the provided name
-// If multiple actors have this name this returns the one that was loaded first
-Actor* SceneDB::FindActorWithName(std::string actor_name)
+// Returns the first enabled actor in an index entry, or nullptr if there isn't one
+static Actor* FindFirstEnabled(const std::unordered_map<std::string, std::vector<Actor*>>& index, const std::string& key)
 {
-    // Actors that have already been loaded
-    for (int i = 0; i < currentScene.actors.size(); i++)
-    {
-        Actor* actor = currentScene.actors[i].get();
-        if (actor->name == actor_name && actor->enabled == true)
-        {
-            return actor;
-        }
-    }
+    auto indexed = index.find(key);
+    if (indexed == index.end()) {return nullptr;}
     
-    // Find should still be able to get actors that have been created this frame
-    for (auto actor : currentScene.actorsToAdd)
+    for (Actor* actor : indexed->second)
     {
-        if (actor->name == actor_name && actor->enabled == true)
+        if (actor->enabled == true)
         {
-            return actor.get();
+            return actor;
         }
     }
     
-    return luabridge::LuaRef(ComponentDB::luaState);
+    return nullptr;
 }
 
-// Finds all actors in the currentScene that have the provided name
-luabridge::LuaRef SceneDB::FindAllActorsWithName(std::string actor_name)
+// Puts every enabled actor in an index entry into a new Lua table
+static luabridge::LuaRef FindAllEnabled(const std::unordered_map<std::string, std::vector<Actor*>>& index, const std::string& key)
 {
-    // Creates and gets a reference to a new table on the Lua stack
-    lua_newtable(ComponentDB::luaState);
-    luabridge::LuaRef actorsWithName(luabridge::get<luabridge::LuaRef>(ComponentDB::luaState, -1));
+    auto indexed = index.find(key);
+    int numActors = indexed != index.end() ? static_cast<int>(indexed->second.size()) : 0;
     
-    actorsWithName[0] = luabridge::LuaRef(ComponentDB::luaState);
+    // Creates and gets a reference to a new table on the Lua stack
+    lua_createtable(ComponentDB::luaState, numActors, 0);
+    luabridge::LuaRef actorsFound(luabridge::get<luabridge::LuaRef>(ComponentDB::luaState, -1));
+    lua_pop(ComponentDB::luaState, 1);
     
-    int index = 1;
+    if (indexed == index.end()) {return actorsFound;}
     
-    for (auto actor : currentScene.actors)
+    int i = 1;
+    for (Actor* actor : indexed->second)
     {
-        if (actor.second->name == actor_name && actor.second->enabled == true)
+        if (actor->enabled == true)
         {
-            actorsWithName[index] = actor.second.get();
-            index++;
+            actorsFound[i] = ActorRef(actor);
+            i++;
         }
     }
     
-    for (auto actor : currentScene.actorsToAdd)
-    {
-        if (actor->name == actor_name && actor->enabled == true)
-        {
-            actorsWithName[index] = actor.get();
-            index++;
-        }
-    }
-    
-    return actorsWithName;
+    return actorsFound;
+}
+
+// Finds an actor in the currentScene that has the provided name
+// If multiple actors have this name this returns the one that was loaded first
+ActorRef SceneDB::FindActorWithName(std::string actor_name)
+{
+    return ActorRef(FindFirstEnabled(currentScene.actorsByName, actor_name));
+}
+
+// Finds all actors in the currentScene that have the provided name
+luabridge::LuaRef SceneDB::FindAllActorsWithName(std::string actor_name)
+{
+    return FindAllEnabled(currentScene.actorsByName, actor_name);
+}
+
+// Finds an actor in the currentScene that has the provided tag
+// If multiple actors have this tag this returns the one that was tagged first
+ActorRef SceneDB::FindActorWithTag(std::string tag)
+{
+    return ActorRef(FindFirstEnabled(currentScene.actorsByTag, tag));
+}
+
+// Finds all actors in the currentScene that have the provided tag
+luabridge::LuaRef SceneDB::FindAllActorsWithTag(std::string tag)
+{
+    return FindAllEnabled(currentScene.actorsByTag, tag);
 }
 
 // Finds an actor with the given UUID
 std::shared_ptr<Actor> SceneDB::FindActorByID(int ID)
 {
     // Actors that have already been loaded
-    if (currentScene.actors.find(ID) != currentScene.actors.end())
+    Actor* actor = currentScene.actors.FindByID(ID);
+    if (actor != nullptr && actor->enabled == true)
     {
-        if (currentScene.actors[ID]->enabled == true)
-        {
-            return currentScene.actors[ID];
-        }
+        return currentScene.actors.GetShared(actor->handle);
     }
     
     // Find should still be able to get actors that have been created this frame
-    for (auto actor : currentScene.actorsToAdd)
+    for (auto actorToAdd : currentScene.actorsToAdd)
     {
-        if (actor->ID == ID && actor->enabled == true)
+        if (actorToAdd->ID == ID && actorToAdd->enabled == true)
         {
-            return actor;
+            return actorToAdd;
         }
     }
     
-    return luabridge::LuaRef(ComponentDB::luaState);
+    return nullptr;
 }
 
 // Creates a new actor and adds it to the current scene
-Actor* SceneDB::Instantiate(std::string actor_template_name)
+ActorRef SceneDB::Instantiate(std::string actor_template_name)
 {
-    return currentScene.AddNewActor(actor_template_name);
+    return ActorRef(currentScene.AddNewActor(actor_template_name));
 }
 
-// Destroys an actor and removes it from the sccene
-void SceneDB::Destroy(Actor* actor)
+// Creates count actors from the same template and adds them to the current scene, then returns them in a Lua array
+luabridge::LuaRef SceneDB::InstantiateMany(std::string actor_template_name, int count)
+{
+    // Local so an "OnReset" that instantiates more actors can't clear it while it's being filled
+    std::vector<Actor*> newActors;
+    currentScene.AddNewActors(actor_template_name, count, newActors);
+    
+    lua_State* luaState = ComponentDB::luaState;
+    lua_createtable(luaState, static_cast<int>(newActors.size()), 0);
+    for (size_t i = 0; i < newActors.size(); i++)
+    {
+        luabridge::Stack<ActorRef>::push(luaState, ActorRef(newActors[i]));
+        lua_rawseti(luaState, -2, static_cast<lua_Integer>(i + 1));
+    }
+    
+    return luabridge::LuaRef::fromStack(luaState);
+}
+
+// Destroys an actor and removes it from the sccene, does nothing if it's already gone
+void SceneDB::Destroy(ActorRef actor)
+{
+    // Lua can pass in actors that were never found or have already been removed from the scene
+    Actor* toDestroy = actor.Get();
+    if (toDestroy == nullptr) {return;}
+    
+    DestroyActor(toDestroy);
+}
+    
+// Marks an actor in the current scene as destroyed and queues its components to be removed
+void SceneDB::DestroyActor(Actor* actor)
 {
     // Do not destroy an actor twice
     if (actor->destroyed) {return;}
     
+    // Its components are all removed when the actor's removed components are processed
     actor->destroyed = true;
     actor->enabled = false;
     
-    // Adds all components to be removed
-    for (auto& member : actor->components)
-    {
-        actor->componentsToRemove.push_back((*member.second)["key"]);
-    }
-    
-    currentScene.actorsToDestroy.push_back(actor->ID);
+    currentScene.actorsToDestroy.push_back(actor);
+    currentScene.QueueRemovedComponents(actor);
 }
 
 // Sets camera position
@@ -12,7 +12,7 @@
 #include "TemplateDB.h"
 
 // TemplateDB (Data Base) Class:
-// Loads all of the templates in the resources/actor_templates directory into loadedTemplates
+// Loads all of the templates in the resources/actor_templates directory into blueprints
 void TemplateDB::LoadTemplates()
 {
     /* Load template files in resources/actor_templates */
@@ -28,23 +28,51 @@ void TemplateDB::LoadTemplates()
                 rapidjson::Document templateDocument;
                 EngineUtils::ReadJsonFile(templateFile.path().string(), templateDocument);
                 
-                Actor newTemplate;
-                newTemplate.LoadActorWithJSON(templateDocument);
+                // Loaded in place so clones inherit straight from the template's components
+                std::string templateName = templateFile.path().filename().stem().stem().string();
+                ActorBlueprint& blueprint = blueprints[templateName];
+                blueprint.templateName = templateName;
+                blueprint.templateActor.LoadActorWithJSON(templateDocument);
                 
-                loadedTemplates[templateFile.path().filename().stem().stem().string()] = newTemplate;
+                Compile(blueprint);
             }
         }
     }
 }
 
-// Get an actor template from loadedTemplates based on the templates name
-Actor TemplateDB::GetTemplate(std::string templateName)
+// Get a compiled template from blueprints based on the templates name
+const ActorBlueprint& TemplateDB::GetBlueprint(const std::string& templateName)
 {
-    if (loadedTemplates.find(templateName) == loadedTemplates.end())
+    auto blueprint = blueprints.find(templateName);
+    if (blueprint == blueprints.end())
     {
         std::cout << "error: template " << templateName << " is missing";
         exit(0);
     }
-    return loadedTemplates[templateName];
+    return blueprint->second;
 }
 
+// Returns the loaded template with the given name without copying it, or nullptr if there isn't one
+const Actor* TemplateDB::FindTemplate(const std::string& templateName)
+{
+    auto blueprint = blueprints.find(templateName);
+    if (blueprint == blueprints.end()) {return nullptr;}
+    return &blueprint->second.templateActor;
+}
+
+// Works out everything cloning a loaded template needs ahead of time
+void TemplateDB::Compile(ActorBlueprint& blueprint)
+{
+    blueprint.components.clear();
+    
+    for (auto& component : blueprint.templateActor.componentsToAdd)
+    {
+        // Clones copy these references instead of looking the functions up themselves
+        component.second->ResolveFunctions();
+        
+        ComponentBlueprint componentBlueprint;
+        componentBlueprint.source = component.second;
+        componentBlueprint.isCPP = ComponentDB::IsComponentTypeCPP(component.second->type);
+        blueprint.components.push_back(componentBlueprint);
+    }
+}
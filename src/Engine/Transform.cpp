@@ -0,0 +1,433 @@
+//
+//  Transform.cpp
+//  game_engine
+//
+//  Created by Jacob Robinson on 5/17/24.
+//  Created for EECS 498: Game Engine Architecture at the University of Michigan
+//
+//  School Email: mrjacob@umich.edu
+
+#include <stdio.h>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include "Transform.h"
+#include "PhysicsHandler.h"
+#include "Profiler.h"
+
+// TransformHandler Class
+// Gives a Transform a slot with default values
+int TransformHandler::Allocate(Transform* owner)
+{
+    int slot;
+    if (!freeSlots.empty())
+    {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<int>(parents.size());
+        
+        localX.push_back(0.0f);
+        localY.push_back(0.0f);
+        localRotation.push_back(0.0f);
+        localScaleX.push_back(1.0f);
+        localScaleY.push_back(1.0f);
+        worldX.push_back(0.0f);
+        worldY.push_back(0.0f);
+        worldRotation.push_back(0.0f);
+        worldScaleX.push_back(1.0f);
+        worldScaleY.push_back(1.0f);
+        parents.push_back(-1);
+        childCounts.push_back(0);
+        dirty.push_back(0);
+        bodies.push_back(nullptr);
+        owners.push_back(nullptr);
+    }
+    
+    localX[slot] = 0.0f;
+    localY[slot] = 0.0f;
+    localRotation[slot] = 0.0f;
+    localScaleX[slot] = 1.0f;
+    localScaleY[slot] = 1.0f;
+    parents[slot] = -1;
+    childCounts[slot] = 0;
+    dirty[slot] = 1;
+    bodies[slot] = nullptr;
+    owners[slot] = owner;
+    
+    return slot;
+}
+
+// Frees a slot, its children keep where they are in the world and lose their parent
+void TransformHandler::Free(int slot)
+{
+    if (slot < 0) {return;}
+    
+    for (int child = 0; childCounts[slot] > 0 && child < static_cast<int>(parents.size()); child++)
+    {
+        if (parents[child] != slot) {continue;}
+        
+        ResolveWorld(child);
+        localX[child] = worldX[child];
+        localY[child] = worldY[child];
+        localRotation[child] = worldRotation[child];
+        localScaleX[child] = worldScaleX[child];
+        localScaleY[child] = worldScaleY[child];
+        SetParent(child, -1);
+    }
+    
+    SetParent(slot, -1);
+    bodies[slot] = nullptr;
+    owners[slot] = nullptr;
+    freeSlots.push_back(slot);
+}
+
+// Parents one slot to another, -1 removes its parent. Returns false if it would make a loop
+bool TransformHandler::SetParent(int slot, int parent)
+{
+    for (int ancestor = parent; ancestor >= 0; ancestor = parents[ancestor])
+    {
+        if (ancestor == slot) {return false;}
+    }
+    
+    if (parents[slot] == parent) {return true;}
+    
+    if (parents[slot] >= 0)
+    {
+        childCounts[parents[slot]]--;
+    }
+    if (parent >= 0)
+    {
+        childCounts[parent]++;
+    }
+    
+    parents[slot] = parent;
+    dirty[slot] = 1;
+    hierarchyChanged = true;
+    return true;
+}
+
+// Makes sure a slot's world values are up to date, returns true if they had to be worked out again
+bool TransformHandler::ResolveWorld(int slot)
+{
+    int parent = parents[slot];
+    bool parentChanged = parent >= 0 && ResolveWorld(parent);
+    
+    if (!dirty[slot] && !parentChanged) {return false;}
+    
+    ComputeWorld(slot);
+    return true;
+}
+
+// Works out the world values of every transform, roots first then children after their parents
+void TransformHandler::UpdateWorldTransforms()
+{
+    PROFILE_SCOPE("TransformHandler::UpdateWorldTransforms");
+    
+    size_t count = parents.size();
+    
+    if (hierarchyChanged)
+    {
+        RebuildChildOrder();
+    }
+    
+    // Transforms with a body go where it is, blended between fixed ticks like anything else that is drawn.
+    // Roots first, then children in order so a parent that follows a body has already been moved
+    for (size_t i = 0; i < count; i++)
+    {
+        if (bodies[i] == nullptr || parents[i] >= 0) {continue;}
+        FollowBody(static_cast<int>(i));
+    }
+    for (int slot : childOrder)
+    {
+        if (bodies[slot] == nullptr) {continue;}
+        FollowBody(slot);
+    }
+    
+    // Roots are where their local values say, this has no branches so the compiler can vectorize it
+    const int* parent = parents.data();
+    for (size_t i = 0; i < count; i++)
+    {
+        bool root = parent[i] < 0;
+        worldX[i] = root ? localX[i] : worldX[i];
+        worldY[i] = root ? localY[i] : worldY[i];
+        worldRotation[i] = root ? localRotation[i] : worldRotation[i];
+        worldScaleX[i] = root ? localScaleX[i] : worldScaleX[i];
+        worldScaleY[i] = root ? localScaleY[i] : worldScaleY[i];
+    }
+    
+    // Children are only worked out again if they or something above them changed
+    for (int slot : childOrder)
+    {
+        if (dirty[parent[slot]])
+        {
+            dirty[slot] = 1;
+        }
+        if (dirty[slot])
+        {
+            ComputeWorld(slot);
+        }
+    }
+    
+    std::fill(dirty.begin(), dirty.end(), 0);
+}
+
+// Works out a slot's world values from its parent's
+void TransformHandler::ComputeWorld(int slot)
+{
+    int parent = parents[slot];
+    if (parent < 0)
+    {
+        worldX[slot] = localX[slot];
+        worldY[slot] = localY[slot];
+        worldRotation[slot] = localRotation[slot];
+        worldScaleX[slot] = localScaleX[slot];
+        worldScaleY[slot] = localScaleY[slot];
+        return;
+    }
+    
+    float radians = worldRotation[parent] * (b2_pi / 180.0f);
+    float cosine = std::cos(radians);
+    float sine = std::sin(radians);
+    
+    float scaledX = localX[slot] * worldScaleX[parent];
+    float scaledY = localY[slot] * worldScaleY[parent];
+    
+    worldX[slot] = worldX[parent] + scaledX * cosine - scaledY * sine;
+    worldY[slot] = worldY[parent] + scaledX * sine + scaledY * cosine;
+    worldRotation[slot] = worldRotation[parent] + localRotation[slot];
+    worldScaleX[slot] = worldScaleX[parent] * localScaleX[slot];
+    worldScaleY[slot] = worldScaleY[parent] * localScaleY[slot];
+}
+
+// Sets a slot's local values so it ends up at its body's world pose, undoing its parent's world transform if it has one
+void TransformHandler::FollowBody(int slot)
+{
+    b2Body* body = bodies[slot];
+    b2Vec2 position = PhysicsHandler::GetInterpolatedPosition(body);
+    float rotation = PhysicsHandler::GetInterpolatedAngle(body) * (180.0f / b2_pi);
+    dirty[slot] = 1;
+    
+    int parent = parents[slot];
+    if (parent < 0)
+    {
+        localX[slot] = position.x;
+        localY[slot] = position.y;
+        localRotation[slot] = rotation;
+        return;
+    }
+    
+    ResolveWorld(parent);
+    
+    float radians = worldRotation[parent] * (b2_pi / 180.0f);
+    float cosine = std::cos(radians);
+    float sine = std::sin(radians);
+    
+    float offsetX = position.x - worldX[parent];
+    float offsetY = position.y - worldY[parent];
+    float rotatedX = offsetX * cosine + offsetY * sine;
+    float rotatedY = offsetY * cosine - offsetX * sine;
+    
+    localX[slot] = worldScaleX[parent] != 0.0f ? rotatedX / worldScaleX[parent] : 0.0f;
+    localY[slot] = worldScaleY[parent] != 0.0f ? rotatedY / worldScaleY[parent] : 0.0f;
+    localRotation[slot] = rotation - worldRotation[parent];
+}
+
+// Sorts the transforms with parents by how deep they are in their hierarchy
+void TransformHandler::RebuildChildOrder()
+{
+    childOrder.clear();
+    
+    std::vector<std::pair<int, int>> depths;
+    for (int slot = 0; slot < static_cast<int>(parents.size()); slot++)
+    {
+        if (parents[slot] < 0) {continue;}
+        
+        int depth = 0;
+        for (int ancestor = parents[slot]; ancestor >= 0; ancestor = parents[ancestor])
+        {
+            depth++;
+        }
+        depths.push_back({depth, slot});
+    }
+    
+    std::sort(depths.begin(), depths.end());
+    for (auto& depth : depths)
+    {
+        childOrder.push_back(depth.second);
+    }
+    
+    hierarchyChanged = false;
+}
+
+// Transform Class
+Transform::Transform() : NativeComponent("Transform")
+{
+    slot = TransformHandler::Allocate(this);
+}
+
+Transform::Transform(const Transform& other) : NativeComponent(other)
+{
+    slot = TransformHandler::Allocate(this);
+    *this = other;
+}
+
+Transform& Transform::operator=(const Transform& other)
+{
+    NativeComponent::operator=(other);
+    
+    // A transform reused after being destroyed needs a slot again
+    if (slot < 0)
+    {
+        slot = TransformHandler::Allocate(this);
+    }
+    if (other.slot < 0 || &other == this) {return *this;}
+    
+    TransformHandler::localX[slot] = TransformHandler::localX[other.slot];
+    TransformHandler::localY[slot] = TransformHandler::localY[other.slot];
+    TransformHandler::localRotation[slot] = TransformHandler::localRotation[other.slot];
+    TransformHandler::localScaleX[slot] = TransformHandler::localScaleX[other.slot];
+    TransformHandler::localScaleY[slot] = TransformHandler::localScaleY[other.slot];
+    TransformHandler::SetParent(slot, TransformHandler::parents[other.slot]);
+    TransformHandler::bodies[slot] = nullptr;
+    
+    return *this;
+}
+
+Transform::~Transform()
+{
+    TransformHandler::Free(slot);
+}
+
+// Local values, these are what the component's JSON sets
+float Transform::GetX() const {return slot >= 0 ? TransformHandler::localX[slot] : 0.0f;}
+float Transform::GetY() const {return slot >= 0 ? TransformHandler::localY[slot] : 0.0f;}
+float Transform::GetRotation() const {return slot >= 0 ? TransformHandler::localRotation[slot] : 0.0f;}
+float Transform::GetScaleX() const {return slot >= 0 ? TransformHandler::localScaleX[slot] : 1.0f;}
+float Transform::GetScaleY() const {return slot >= 0 ? TransformHandler::localScaleY[slot] : 1.0f;}
+
+void Transform::SetX(float x)
+{
+    if (slot < 0) {return;}
+    TransformHandler::localX[slot] = x;
+    TransformHandler::dirty[slot] = 1;
+    MoveBody();
+}
+void Transform::SetY(float y)
+{
+    if (slot < 0) {return;}
+    TransformHandler::localY[slot] = y;
+    TransformHandler::dirty[slot] = 1;
+    MoveBody();
+}
+void Transform::SetRotation(float degrees_clockwise)
+{
+    if (slot < 0) {return;}
+    TransformHandler::localRotation[slot] = degrees_clockwise;
+    TransformHandler::dirty[slot] = 1;
+    MoveBody();
+}
+void Transform::SetScaleX(float scale_x)
+{
+    if (slot < 0) {return;}
+    TransformHandler::localScaleX[slot] = scale_x;
+    TransformHandler::dirty[slot] = 1;
+}
+void Transform::SetScaleY(float scale_y)
+{
+    if (slot < 0) {return;}
+    TransformHandler::localScaleY[slot] = scale_y;
+    TransformHandler::dirty[slot] = 1;
+}
+
+b2Vec2 Transform::GetPosition() {return b2Vec2(GetX(), GetY());}
+void Transform::SetPosition(b2Vec2 position)
+{
+    if (slot < 0) {return;}
+    TransformHandler::localX[slot] = position.x;
+    TransformHandler::localY[slot] = position.y;
+    TransformHandler::dirty[slot] = 1;
+    MoveBody();
+}
+
+// World values, worked out on the spot if anything changed since the last update
+b2Vec2 Transform::GetWorldPosition()
+{
+    if (slot < 0) {return b2Vec2(0.0f, 0.0f);}
+    TransformHandler::ResolveWorld(slot);
+    return b2Vec2(TransformHandler::worldX[slot], TransformHandler::worldY[slot]);
+}
+
+float Transform::GetWorldRotation()
+{
+    if (slot < 0) {return 0.0f;}
+    TransformHandler::ResolveWorld(slot);
+    return TransformHandler::worldRotation[slot];
+}
+
+b2Vec2 Transform::GetWorldScale()
+{
+    if (slot < 0) {return b2Vec2(1.0f, 1.0f);}
+    TransformHandler::ResolveWorld(slot);
+    return b2Vec2(TransformHandler::worldScaleX[slot], TransformHandler::worldScaleY[slot]);
+}
+
+// Parenting, nil removes the parent. The local values are kept and become relative to the new parent
+void Transform::SetParent(Transform* parent)
+{
+    if (slot < 0) {return;}
+    
+    int parentSlot = parent != nullptr ? parent->slot : -1;
+    if (!TransformHandler::SetParent(slot, parentSlot))
+    {
+        std::cout << "\033[31m" << key << " : a transform can't be parented to one of its children" << "\033[0m" << std::endl;
+    }
+}
+
+Transform* Transform::GetParent()
+{
+    if (slot < 0 || TransformHandler::parents[slot] < 0) {return nullptr;}
+    return TransformHandler::owners[TransformHandler::parents[slot]];
+}
+
+// Makes this transform follow a body, which is moved along with it when it is set from Lua
+void Transform::AttachBody(b2Body* body)
+{
+    if (slot < 0) {return;}
+    TransformHandler::bodies[slot] = body;
+}
+
+void Transform::DetachBody()
+{
+    if (slot < 0) {return;}
+    TransformHandler::bodies[slot] = nullptr;
+}
+
+// Moves the attached body to where the world values say it should be, bodies don't know about parents
+void Transform::MoveBody()
+{
+    b2Body* body = TransformHandler::bodies[slot];
+    if (body == nullptr) {return;}
+    
+    TransformHandler::ResolveWorld(slot);
+    body->SetTransform(b2Vec2(TransformHandler::worldX[slot], TransformHandler::worldY[slot]), TransformHandler::worldRotation[slot] * (b2_pi / 180.0f));
+}
+
+void Transform::OnDestroy()
+{
+    // The Rigidbody this transform follows lets go of it, otherwise it would detach whatever reuses this transform once it is destroyed
+    if (slot >= 0 && TransformHandler::bodies[slot] != nullptr)
+    {
+        Rigidbody* rigidbody = reinterpret_cast<Rigidbody*>(TransformHandler::bodies[slot]->GetUserData().pointer);
+        if (rigidbody != nullptr && rigidbody->transform == this)
+        {
+            rigidbody->transform = nullptr;
+        }
+    }
+    
+    TransformHandler::Free(slot);
+    slot = -1;
+}